@@ -114,11 +114,24 @@ type context
 type surface
 type content = COLOR | ALPHA | COLOR_ALPHA
 type 'a pattern
-  constraint 'a = [<`Solid | `Surface | `Gradient | `Linear | `Radial]
-type any_pattern = [`Solid | `Surface | `Gradient | `Linear | `Radial] pattern
+  constraint 'a = [<`Solid | `Surface | `Gradient | `Linear | `Radial | `Mesh
+                  | `Raster_source]
+type any_pattern =
+  [`Solid | `Surface | `Gradient | `Linear | `Radial | `Mesh
+  | `Raster_source] pattern
 type glyph = { index: int;  x: float;  y: float }
 
+(* Apply [f] to [x] and destroy [x] afterwards, even if [f] raises. *)
+let with_destroy destroy x f =
+  match f x with
+  | r -> destroy x; r
+  | exception e -> destroy x; raise e
+
 external create : surface -> context = "caml_cairo_create"
+external destroy : context -> unit = "caml_cairo_destroy" [@@noalloc]
+
+let with_context surf f = with_destroy destroy (create surf) f
+
 external save : context -> unit = "caml_cairo_save"
 external restore : context -> unit = "caml_cairo_restore"
 
@@ -271,6 +284,40 @@ external stroke_extents : context -> rectangle = "caml_cairo_stroke_extents"
 external in_stroke : context -> float -> float -> bool
   = "caml_cairo_in_stroke"
 
+type insideness =
+  (int, Bigarray.int8_unsigned_elt, Bigarray.c_layout) Bigarray.Array1.t
+
+external in_fill_many_stub :
+  context -> (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t
+  -> insideness -> unit = "caml_cairo_in_fill_many"
+external in_stroke_many_stub :
+  context -> (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t
+  -> insideness -> unit = "caml_cairo_in_stroke_many"
+external in_clip_many_stub :
+  context -> (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t
+  -> insideness -> unit = "caml_cairo_in_clip_many"
+
+let in_many fname stub cr ?dst pts =
+  let open Bigarray in
+  let n = Array1.dim pts in
+  if n land 1 <> 0 then invalid_arg("Cairo." ^ fname ^ ": odd length");
+  let dst = match dst with
+    | None -> Array1.create int8_unsigned c_layout (n / 2)
+    | Some dst ->
+       if Array1.dim dst <> n / 2 then
+         invalid_arg("Cairo." ^ fname ^ ": dst must have half the length \
+                      of the points");
+       dst in
+  stub cr pts dst;
+  dst
+
+let in_fill_many cr ?dst pts =
+  in_many "in_fill_many" in_fill_many_stub cr ?dst pts
+let in_stroke_many cr ?dst pts =
+  in_many "in_stroke_many" in_stroke_many_stub cr ?dst pts
+let in_clip_many cr ?dst pts =
+  in_many "in_clip_many" in_clip_many_stub cr ?dst pts
+
 external copy_page : context -> unit = "caml_cairo_copy_page"
 external show_page : context -> unit = "caml_cairo_show_page"
 
@@ -288,6 +335,8 @@ struct
 
   external copy : context -> t = "caml_cairo_copy_path"
   external copy_flat : context -> t = "caml_cairo_copy_path_flat"
+  external destroy : t -> unit = "caml_cairo_path_destroy" [@@noalloc]
+  let with_path path f = with_destroy destroy path f
   external append : context -> t -> unit = "caml_cairo_append_path"
   external get_current_point : context -> float * float
     = "caml_cairo_get_current_point"
@@ -303,32 +352,102 @@ struct
     = "caml_cairo_path_fold"
   external to_array : t -> path_data array = "caml_cairo_path_to_array"
   external of_array : path_data array -> t = "caml_cairo_path_of_array"
-end
-
 
-external arc : context -> float -> float -> r:float -> a1:float -> a2:float
-  -> unit = "caml_cairo_arc_bc" "caml_cairo_arc"
-external arc_negative : context -> float -> float -> r:float -> a1:float ->
-  a2:float -> unit = "caml_cairo_arc_negative_bc" "caml_cairo_arc_negative"
-
-external curve_to : context -> float -> float -> float -> float ->
-                    float -> float -> unit
-  = "caml_cairo_curve_to_bc" "caml_cairo_curve_to"
+  open Bigarray
 
-external line_to : context -> float -> float -> unit = "caml_cairo_line_to"
-external move_to : context -> float -> float -> unit = "caml_cairo_move_to"
-external rectangle :
-  context -> float -> float -> w:float -> h:float -> unit
-  = "caml_cairo_rectangle"
+  external lines_of_bigarray_stub :
+    context -> (float, float64_elt, c_layout) Array1.t -> bool -> unit
+    = "caml_cairo_path_lines_of_bigarray"
+  external curves_of_bigarray_stub :
+    context -> (float, float64_elt, c_layout) Array1.t -> bool -> unit
+    = "caml_cairo_path_curves_of_bigarray"
+
+  let lines_of_bigarray cr ?(closed=false) data =
+    if Array1.dim data land 1 <> 0 then
+      invalid_arg "Cairo.Path.lines_of_bigarray: odd length";
+    lines_of_bigarray_stub cr data closed
+
+  let curves_of_bigarray cr ?(closed=false) data =
+    let n = Array1.dim data in
+    if n > 0 && (n - 2) mod 6 <> 0 then
+      invalid_arg "Cairo.Path.curves_of_bigarray: the length must be of \
+                   the form 2 + 6k";
+    curves_of_bigarray_stub cr data closed
+
+  type data = (float, float64_elt, c_layout) Array2.t
+
+  (* Keep in sync with cairo_path_data_type_t *)
+  type element_type =
+    | PATH_MOVE_TO
+    | PATH_LINE_TO
+    | PATH_CURVE_TO
+    | PATH_CLOSE_PATH
+
+  external to_bigarray : t -> data = "caml_cairo_path_to_bigarray"
+  external of_bigarray_stub : data -> t = "caml_cairo_path_of_bigarray"
+
+  let of_bigarray data =
+    if Array2.dim2 data <> 2 then
+      invalid_arg "Cairo.Path.of_bigarray: Array2.dim2 data <> 2";
+    of_bigarray_stub data
+
+  external unsafe_get_type : data -> int -> element_type
+    = "caml_cairo_path_data_get_type"
+  external unsafe_get_length : data -> int -> int
+    = "caml_cairo_path_data_get_length" [@@noalloc]
+  external unsafe_set_header : data -> int -> element_type -> unit
+    = "caml_cairo_path_data_set_header" [@@noalloc]
+
+  let check_row fname data i =
+    if i < 0 || i >= Array2.dim1 data || Array2.dim2 data <> 2 then
+      invalid_arg("Cairo.Path." ^ fname ^ ": index out of bounds")
+
+  let get_type data i =
+    check_row "get_type" data i;
+    unsafe_get_type data i
+
+  let get_length data i =
+    check_row "get_length" data i;
+    unsafe_get_length data i
+
+  let set_header data i ty =
+    check_row "set_header" data i;
+    unsafe_set_header data i ty
+end
 
-external rel_curve_to : context -> float -> float ->
-                        float -> float -> float -> float -> unit
-  = "caml_cairo_rel_curve_to_bc" "caml_cairo_rel_curve_to"
 
-external rel_line_to : context -> float -> float -> unit
-  = "caml_cairo_rel_line_to"
-external rel_move_to : context -> float -> float -> unit
-  = "caml_cairo_rel_move_to"
+(* The native code versions take unboxed floats.  Neither version
+   checks the status of the context (see DO2_CONTEXT_UNBOXED). *)
+external arc : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+  r:(float [@unboxed]) -> a1:(float [@unboxed]) -> a2:(float [@unboxed]) ->
+  unit = "caml_cairo_arc_bc" "caml_cairo_arc_unboxed" [@@noalloc]
+external arc_negative : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+  r:(float [@unboxed]) -> a1:(float [@unboxed]) -> a2:(float [@unboxed]) ->
+  unit = "caml_cairo_arc_negative_bc" "caml_cairo_arc_negative_unboxed"
+  [@@noalloc]
+
+external curve_to : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+                    (float [@unboxed]) -> (float [@unboxed]) ->
+                    (float [@unboxed]) -> (float [@unboxed]) -> unit
+  = "caml_cairo_curve_to_bc" "caml_cairo_curve_to_unboxed" [@@noalloc]
+
+external line_to : context -> (float [@unboxed]) -> (float [@unboxed]) -> unit
+  = "caml_cairo_line_to" "caml_cairo_line_to_unboxed" [@@noalloc]
+external move_to : context -> (float [@unboxed]) -> (float [@unboxed]) -> unit
+  = "caml_cairo_move_to" "caml_cairo_move_to_unboxed" [@@noalloc]
+external rectangle : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+  w:(float [@unboxed]) -> h:(float [@unboxed]) -> unit
+  = "caml_cairo_rectangle" "caml_cairo_rectangle_unboxed" [@@noalloc]
+
+external rel_curve_to : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+                        (float [@unboxed]) -> (float [@unboxed]) ->
+                        (float [@unboxed]) -> (float [@unboxed]) -> unit
+  = "caml_cairo_rel_curve_to_bc" "caml_cairo_rel_curve_to_unboxed" [@@noalloc]
+
+external rel_line_to : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+  unit = "caml_cairo_rel_line_to" "caml_cairo_rel_line_to_unboxed" [@@noalloc]
+external rel_move_to : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+  unit = "caml_cairo_rel_move_to" "caml_cairo_rel_move_to_unboxed" [@@noalloc]
 
 
 (* ---------------------------------------------------------------------- *)
@@ -417,6 +536,34 @@ struct
   let transform_point m x y =
     (m.xx *. x +. m.xy *. y +. m.x0,  m.yx *. x +. m.yy *. y +. m.y0)
 
+  open Bigarray
+
+  type points = (float, float64_elt, c_layout) Array1.t
+
+  (* Return the destination after checking it is compatible with [src]. *)
+  let check_points fname ?dst (src: points) =
+    let n = Array1.dim src in
+    if n land 1 <> 0 then invalid_arg("Cairo." ^ fname ^ ": odd length");
+    match dst with
+    | None -> src
+    | Some dst ->
+       if Array1.dim dst <> n then
+         invalid_arg("Cairo." ^ fname ^ ": dst and src must have the same \
+                      length");
+       dst
+
+  external transform_points_stub : t -> points -> points -> unit
+    = "caml_cairo_matrix_transform_points" [@@noalloc]
+  external transform_distances_stub : t -> points -> points -> unit
+    = "caml_cairo_matrix_transform_distances" [@@noalloc]
+
+  let transform_points m ?dst src =
+    transform_points_stub m src
+      (check_points "Matrix.transform_points" ?dst src)
+
+  let transform_distances m ?dst src =
+    transform_distances_stub m src
+      (check_points "Matrix.transform_distances" ?dst src)
 end
 
 (* ---------------------------------------------------------------------- *)
@@ -541,6 +688,92 @@ struct
   external show : context -> t array -> unit = "caml_cairo_show_glyphs"
   external show_text : context -> string -> t array ->
     cluster array -> cluster_flags -> unit = "caml_cairo_show_text_glyphs"
+
+  type glyph = t
+
+  module Buffer =
+  struct
+    type t
+
+    external create_stub : int -> t = "caml_cairo_glyph_buffer_create"
+    let create ?(size=64) () =
+      if size < 0 then invalid_arg "Cairo.Glyph.Buffer.create: size < 0";
+      create_stub size
+
+    external length : t -> int = "caml_cairo_glyph_buffer_length" [@@noalloc]
+    external clear : t -> unit = "caml_cairo_glyph_buffer_clear" [@@noalloc]
+
+    external add : t -> (int [@untagged]) ->
+                   (float [@unboxed]) -> (float [@unboxed]) -> unit
+      = "caml_cairo_glyph_buffer_add" "caml_cairo_glyph_buffer_add_unboxed"
+
+    external unsafe_set : t -> (int [@untagged]) -> (int [@untagged]) ->
+                          (float [@unboxed]) -> (float [@unboxed]) -> unit
+      = "caml_cairo_glyph_buffer_set" "caml_cairo_glyph_buffer_set_unboxed"
+      [@@noalloc]
+    external unsafe_get_index : t -> (int [@untagged]) -> (int [@untagged])
+      = "caml_cairo_glyph_buffer_get_index"
+        "caml_cairo_glyph_buffer_get_index_unboxed" [@@noalloc]
+    external unsafe_get_x : t -> (int [@untagged]) -> (float [@unboxed])
+      = "caml_cairo_glyph_buffer_get_x" "caml_cairo_glyph_buffer_get_x_unboxed"
+      [@@noalloc]
+    external unsafe_get_y : t -> (int [@untagged]) -> (float [@unboxed])
+      = "caml_cairo_glyph_buffer_get_y" "caml_cairo_glyph_buffer_get_y_unboxed"
+      [@@noalloc]
+
+    let check b i fname =
+      if i < 0 || i >= length b then
+        invalid_arg("Cairo.Glyph.Buffer." ^ fname ^ ": index out of bounds")
+
+    let set b i ~index ~x ~y =
+      check b i "set";
+      unsafe_set b i index x y
+    let get_index b i = check b i "get_index";  unsafe_get_index b i
+    let get_x b i = check b i "get_x";  unsafe_get_x b i
+    let get_y b i = check b i "get_y";  unsafe_get_y b i
+    let get b i =
+      check b i "get";
+      { index = unsafe_get_index b i;  x = unsafe_get_x b i;
+        y = unsafe_get_y b i }
+
+    let of_array glyphs =
+      let b = create ~size:(Array.length glyphs) () in
+      Array.iter (fun g -> add b g.index g.x g.y) glyphs;
+      b
+
+    let to_array b = Array.init (length b) (fun i -> get b i)
+
+    external num_clusters : t -> int
+      = "caml_cairo_glyph_buffer_num_clusters" [@@noalloc]
+    external backward : t -> bool
+      = "caml_cairo_glyph_buffer_backward" [@@noalloc]
+    external unsafe_get_cluster_bytes : t -> int -> int
+      = "caml_cairo_glyph_buffer_get_cluster_bytes" [@@noalloc]
+    external unsafe_get_cluster_glyphs : t -> int -> int
+      = "caml_cairo_glyph_buffer_get_cluster_glyphs" [@@noalloc]
+
+    let check_cluster b i fname =
+      if i < 0 || i >= num_clusters b then
+        invalid_arg("Cairo.Glyph.Buffer." ^ fname ^ ": index out of bounds")
+
+    let get_cluster_bytes b i =
+      check_cluster b i "get_cluster_bytes";
+      unsafe_get_cluster_bytes b i
+    let get_cluster_glyphs b i =
+      check_cluster b i "get_cluster_glyphs";
+      unsafe_get_cluster_glyphs b i
+    let get_cluster b i =
+      check_cluster b i "get_cluster";
+      { num_bytes = unsafe_get_cluster_bytes b i;
+        num_glyphs = unsafe_get_cluster_glyphs b i }
+
+    external show : context -> t -> unit = "caml_cairo_glyph_buffer_show"
+    external path : context -> t -> unit = "caml_cairo_glyph_buffer_path"
+    external extents : context -> t -> text_extents
+      = "caml_cairo_glyph_buffer_extents"
+    external show_text : context -> string -> t -> unit
+      = "caml_cairo_glyph_buffer_show_text"
+  end
 end
 
 type font_extents = {
@@ -572,6 +805,11 @@ struct
   external text_to_glyphs : _ t -> x:float -> y:float -> string
     -> Glyph.t array * Glyph.cluster array * Glyph.cluster_flags
     = "caml_cairo_scaled_font_text_to_glyphs"
+  external text_to_glyph_buffer : _ t -> x:float -> y:float -> string ->
+                                  Glyph.Buffer.t -> int
+    = "caml_cairo_scaled_font_text_to_glyph_buffer"
+  external glyph_buffer_extents : _ t -> Glyph.Buffer.t -> text_extents
+    = "caml_cairo_scaled_font_glyph_buffer_extents"
 
   external get_font_face : 'a t -> 'a Font_face.t
     = "caml_cairo_scaled_font_get_font_face"
@@ -585,6 +823,93 @@ struct
     = "caml_cairo_scaled_font_get_scale_matrix"
 
   external get_type : _ t -> font_type = "caml_cairo_scaled_font_get_type"
+
+  type 'a scaled_font = 'a t
+
+  module Cache =
+  struct
+    (* Doubly linked list of the runs, most recently used first. *)
+    type 'a entry = {
+      key : ('a scaled_font * string) option; (* None for the sentinel *)
+      run : Glyph.Buffer.t; (* positioned at the origin *)
+      x_advance : float;
+      y_advance : float;
+      mutable prev : 'a entry;
+      mutable next : 'a entry;
+    }
+
+    type 'a t = {
+      size : int;
+      runs : ('a scaled_font * string, 'a entry) Hashtbl.t;
+      lru : 'a entry; (* sentinel *)
+      mutable hits : int;
+      mutable misses : int;
+    }
+
+    let create ?(size=1024) () =
+      if size <= 0 then invalid_arg "Cairo.Scaled_font.Cache.create: size <= 0";
+      let run = Glyph.Buffer.create ~size:0 () in
+      let rec lru = { key = None;  run;  x_advance = 0.;  y_advance = 0.;
+                      prev = lru;  next = lru } in
+      { size;  runs = Hashtbl.create size;  lru;  hits = 0;  misses = 0 }
+
+    let unlink e =
+      e.prev.next <- e.next;
+      e.next.prev <- e.prev
+
+    let push_front c e =
+      e.next <- c.lru.next;
+      e.prev <- c.lru;
+      c.lru.next.prev <- e;
+      c.lru.next <- e
+
+    let clear c =
+      Hashtbl.reset c.runs;
+      c.lru.next <- c.lru;
+      c.lru.prev <- c.lru
+
+    let length c = Hashtbl.length c.runs
+    let hits c = c.hits
+    let misses c = c.misses
+
+    let find_entry c sf text =
+      let key = (sf, text) in
+      match Hashtbl.find c.runs key with
+      | e ->
+         c.hits <- c.hits + 1;
+         unlink e;
+         push_front c e;
+         e
+      | exception Not_found ->
+         c.misses <- c.misses + 1;
+         let run = Glyph.Buffer.create ~size:(String.length text) () in
+         ignore(text_to_glyph_buffer sf ~x:0. ~y:0. text run);
+         let te = glyph_buffer_extents sf run in
+         let rec e = { key = Some key;  run;  x_advance = te.x_advance;
+                       y_advance = te.y_advance;  prev = e;  next = e } in
+         push_front c e;
+         Hashtbl.add c.runs key e;
+         if Hashtbl.length c.runs > c.size then (
+           let last = c.lru.prev in
+           unlink last;
+           match last.key with
+           | Some k -> Hashtbl.remove c.runs k
+           | None -> assert false
+         );
+         e
+
+    let find c sf text = (find_entry c sf text).run
+
+    external show_text_at : context -> string -> Glyph.Buffer.t ->
+                            float -> float -> unit
+      = "caml_cairo_glyph_buffer_show_text_at"
+
+    let show_text c cr text =
+      let e = find_entry c (get cr) text in
+      let x, y = Path.get_current_point cr in
+      show_text_at cr text e.run x y;
+      move_to cr (x +. e.x_advance) (y +. e.y_advance)
+  end
 end
 
 module Ft = struct
@@ -683,7 +1008,13 @@ struct
 
   external create_similar : t -> content -> w:int -> h:int -> t
     = "caml_cairo_surface_create_similar"
+
+  external create_for_rectangle : t -> x:float -> y:float -> w:float ->
+                                  h:float -> t
+    = "caml_cairo_surface_create_for_rectangle"
   external finish : t -> unit = "caml_cairo_surface_finish"
+  external destroy : t -> unit = "caml_cairo_surface_destroy"
+  let with_surface surf f = with_destroy destroy surf f
   external flush : t -> unit = "caml_cairo_surface_flush"
   external get_font_options : t -> Font_options.t
     = "caml_cairo_surface_get_font_options"
@@ -715,19 +1046,65 @@ struct
       | `OS2
       | `Win32_printing
       | `Quartz_image
+      | `Script
+      | `Qt
       | `Recording
+      | `VG
+      | `GL
+      | `DRM
+      | `Tee
+      | `XML
+      | `Skia
+      | `Subsurface
+      | `Cogl
       ]
   external init : unit -> unit = "caml_cairo_surface_kind_init"
   let () = init()
 
   external get_type : t -> kind = "caml_cairo_surface_get_type"
+  external is_image : t -> bool = "caml_cairo_surface_is_image" [@@noalloc]
 
   external copy_page : t -> unit = "caml_cairo_surface_copy_page"
   external show_page : t -> unit = "caml_cairo_surface_show_page"
   external has_show_text_glyphs : t -> bool
     = "caml_cairo_surface_has_show_text_glyphs"
+
+  module Mime =
+  struct
+    let jpeg = "image/jpeg"
+    let png = "image/png"
+    let jp2 = "image/jp2"
+    let uri = "text/x-uri"
+    let unique_id = "application/x-cairo.uuid"
+    let jbig2 = "application/x-cairo.jbig2"
+    let jbig2_global = "application/x-cairo.jbig2-global"
+    let jbig2_global_id = "application/x-cairo.jbig2-global-id"
+  end
+
+  external set_mime_data : t -> string -> string -> unit
+    = "caml_cairo_surface_set_mime_data"
+  external set_mime_data_bigarray :
+    t -> string ->
+    (int, Bigarray.int8_unsigned_elt, Bigarray.c_layout) Bigarray.Array1.t ->
+    unit
+    = "caml_cairo_surface_set_mime_data_bigarray"
+  external remove_mime_data : t -> string -> unit
+    = "caml_cairo_surface_remove_mime_data"
+  external get_mime_data : t -> string -> string option
+    = "caml_cairo_surface_get_mime_data"
+  external supports_mime_type : t -> string -> bool
+    = "caml_cairo_surface_supports_mime_type"
 end
 
+(* Copy the pixels of [src] to [dst] (of the same size). *)
+let copy_pixels src dst =
+  let cr = create dst in
+  set_operator cr SOURCE;
+  set_source_surface cr src ~x:0. ~y:0.;
+  paint cr;
+  destroy cr;
+  Surface.flush dst
+
 module Image =
 struct
   type format =
@@ -809,34 +1186,190 @@ struct
 		   ARGB32 or RGB24";
     get_data32 surface
 
+  external map_to_image : Surface.t -> (int * int * int * int) option ->
+                          Surface.t
+    = "caml_cairo_surface_map_to_image"
+  external unmap_image : Surface.t -> Surface.t -> unit
+    = "caml_cairo_surface_unmap_image"
+  external invalidate : ('a, 'b, c_layout) Array2.t -> unit
+    = "caml_cairo_image_data_invalidate" [@@noalloc]
+
+  let map surface ?x ?y ?w ?h f =
+    let extents = match w, h with
+      | Some w, Some h ->
+         let x = match x with Some x -> x | None -> 0 in
+         let y = match y with Some y -> y | None -> 0 in
+         Some(x, y, w, h)
+      | None, None ->
+         if x <> None || y <> None then
+           invalid_arg "Cairo.Image.map: ~x and ~y require ~w and ~h";
+         None
+      | _ -> invalid_arg "Cairo.Image.map: ~w and ~h must be given together" in
+    let image = map_to_image surface extents in
+    match f image with
+    | r -> unmap_image surface image; r
+    | exception e -> unmap_image surface image; raise e
+
+  let with_data32 f data =
+    match f data with
+    | r -> invalidate data; r
+    | exception e -> invalidate data; raise e
+
+  let map_data32 surface ?x ?y ?w ?h f =
+    map surface ?x ?y ?w ?h (fun image ->
+        let format = get_format image in
+        let width = get_width image in
+        if get_stride image = stride_for_width format width then
+          with_data32 f (get_data32 image)
+        else (
+          (* [image] views a part of an image with longer rows, whose
+             last row cannot be exposed safely as a bigarray of the
+             given stride.  Work on a copy. *)
+          let tmp = create format ~w:width ~h:(get_height image) in
+          copy_pixels image tmp;
+          let write_back () =
+            Surface.mark_dirty tmp;
+            copy_pixels tmp image;
+            Surface.destroy tmp in
+          match with_data32 f (get_data32 tmp) with
+          | r -> write_back (); r
+          | exception e -> write_back (); raise e))
+
+  type output_format = PPM | PAM | RGBA | BGRA
+
+  external export_row : data32 -> int -> output_format -> opaque:bool ->
+                        Bytes.t -> unit
+    = "caml_cairo_image_export_row" [@@noalloc]
+
+  (* Assume [w] and [h] are valid for [data]. *)
+  let output_data fh format ~opaque ~w ~h data =
+    (match format with
+     | PPM -> Printf.fprintf fh "P6\n%d %d\n255\n" w h
+     | PAM -> Printf.fprintf fh "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\n\
+                                MAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n" w h
+     | RGBA | BGRA -> ());
+    let row = Bytes.create (if format = PPM then 3 * w else 4 * w) in
+    for i = 0 to h - 1 do
+      export_row data i format ~opaque row;
+      output fh row 0 (Bytes.length row)
+    done
+
   let output_ppm fh ?w ?h (data: data32) =
     let width = match w with
-      | None -> Array2.dim1 data
+      | None -> Array2.dim2 data
       | Some w ->
-          if w > Array2.dim1 data then
-            invalid_arg "Cairo.Image.output_ppm: width > Array2.dim1 data";
+          if w > Array2.dim2 data then
+            invalid_arg "Cairo.Image.output_ppm: width > Array2.dim2 data";
           if w <= 0 then
             invalid_arg "Cairo.Image.output_ppm: width <= 0";
           w in
     let height = match h with
-      | None -> Array2.dim2 data
+      | None -> Array2.dim1 data
       | Some h ->
-          if h > Array2.dim2 data then
-            invalid_arg "Cairo.Image.output_ppm: height > Array2.dim2 data";
+          if h > Array2.dim1 data then
+            invalid_arg "Cairo.Image.output_ppm: height > Array2.dim1 data";
           if h <= 0 then
             invalid_arg "Cairo.Image.output_ppm: height <= 0";
           h in
-    Printf.fprintf fh "P6 %d %d 255\n" width height;
-    for i = 0 to width - 1 do
-      for j = 0 to height - 1 do
-        (* Output pixel RGB *)
-        let p = Int32.to_int data.{i, j} in
-        output_byte fh ((p lsr 16) land 0xFF);
-        output_byte fh ((p lsr 8) land 0xFF);
-        output_byte fh (p land 0xFF)
-      done
-    done
-      (* flush fh ?? *)
+    output_data fh PPM ~opaque:true ~w:width ~h:height data
+
+  let output fh format surface =
+    let image_format = get_format surface in
+    if image_format <> ARGB32 && image_format <> RGB24 then
+      invalid_arg "Cairo.Image.output: image format must be ARGB32 or RGB24";
+    Surface.flush surface;
+    output_data fh format ~opaque:(image_format = RGB24)
+      ~w:(get_width surface) ~h:(get_height surface) (get_data32 surface)
+
+  external premultiply : data32 -> unit
+    = "caml_cairo_image_premultiply" [@@noalloc]
+  external unpremultiply : data32 -> unit
+    = "caml_cairo_image_unpremultiply" [@@noalloc]
+
+  let check_image fname surface =
+    if not(Surface.is_image surface) then
+      invalid_arg(fname ^ ": not an image surface")
+
+  external convert_unsafe : Surface.t -> Surface.t -> unit
+    = "caml_cairo_image_convert"
+
+  let convert src dst =
+    check_image "Cairo.Image.convert" src;
+    check_image "Cairo.Image.convert" dst;
+    if get_width src <> get_width dst || get_height src <> get_height dst then
+      invalid_arg "Cairo.Image.convert: the images have different sizes";
+    let fsrc = get_format src and fdst = get_format dst in
+    if (fsrc = A1 || fdst = A1) && fsrc <> fdst then
+      invalid_arg "Cairo.Image.convert: A1 can only be copied to A1";
+    Surface.flush src;
+    Surface.flush dst;
+    convert_unsafe src dst;
+    Surface.mark_dirty dst
+
+  type channel_order = [ `RGBA | `BGRA | `ARGB | `ABGR ]
+
+  let int_of_order = function
+    | `RGBA -> 0 | `BGRA -> 1 | `ARGB -> 2 | `ABGR -> 3
+
+  external to_data8_unsafe : Surface.t -> int -> bool -> int -> data8 -> unit
+    = "caml_cairo_image_to_data8" [@@noalloc]
+  external of_data8_unsafe : data8 -> int -> bool -> int -> Surface.t -> unit
+    = "caml_cairo_image_of_data8" [@@noalloc]
+
+  (* Check [surface] and return the stride of the data. *)
+  let data8_stride fname surface stride data =
+    check_image fname surface;
+    let format = get_format surface in
+    if format <> ARGB32 && format <> RGB24 then
+      invalid_arg(fname ^ ": image format must be ARGB32 or RGB24");
+    let w = get_width surface and h = get_height surface in
+    let stride = match stride with
+      | None -> 4 * w
+      | Some s ->
+         if s < 4 * w then invalid_arg(fname ^ ": stride < 4 * width");
+         s in
+    if h > 0 && stride * (h - 1) + 4 * w > Array1.dim data then
+      invalid_arg(Printf.sprintf "%s: bigarray too small for the stride=%i \
+        and height=%i" fname stride h);
+    stride
+
+  let convert_to_data8 surface ?(order=`RGBA) ?(premultiplied=false)
+        ?stride data =
+    let stride = data8_stride "Cairo.Image.convert_to_data8"
+                   surface stride data in
+    Surface.flush surface;
+    to_data8_unsafe surface (int_of_order order) premultiplied stride data
+
+  let convert_of_data8 data ?(order=`RGBA) ?(premultiplied=false)
+        ?stride surface =
+    let stride = data8_stride "Cairo.Image.convert_of_data8"
+                   surface stride data in
+    Surface.flush surface;
+    of_data8_unsafe data (int_of_order order) premultiplied stride surface;
+    Surface.mark_dirty surface
+
+  module Pool =
+  struct
+    type t
+
+    external create_stub : int -> t = "caml_cairo_image_pool_create"
+    external surface_create : t -> bool -> format -> w:int -> h:int ->
+                              Surface.t
+      = "caml_cairo_image_pool_surface_create"
+    external clear : t -> unit = "caml_cairo_image_pool_clear" [@@noalloc]
+    external stats : t -> int * int * int = "caml_cairo_image_pool_stats"
+
+    let create ?(budget=64 * 1024 * 1024) () =
+      if budget < 0 then invalid_arg "Cairo.Image.Pool.create: budget < 0";
+      create_stub budget
+
+    let create_image pool ?(zeroed=true) format ~w ~h =
+      surface_create pool zeroed format ~w ~h
+
+    let size pool = let (s, _, _) = stats pool in s
+    let hits pool = let (_, h, _) = stats pool in h
+    let misses pool = let (_, _, m) = stats pool in m
+  end
 end
 
 module PDF =
@@ -863,11 +1396,36 @@ struct
     = "caml_cairo_image_surface_create_from_png_stream"
     (* FIXME: must hold the input function to avoid it is being
        reclaimed before the surface? *)
+  external of_string : string -> Surface.t
+    = "caml_cairo_image_surface_create_from_png_string"
+  external of_bigarray : Image.data8 -> Surface.t
+    = "caml_cairo_image_surface_create_from_png_bigarray"
 
   external write : Surface.t -> string -> unit
     = "caml_cairo_surface_write_to_png"
   external write_to_stream : Surface.t -> (string -> unit) -> unit
     = "caml_cairo_surface_write_to_png_stream"
+  external write_to_string : Surface.t -> string
+    = "caml_cairo_surface_write_to_png_string"
+  external write_to_bigarray : Surface.t -> Image.data8
+    = "caml_cairo_surface_write_to_png_bigarray"
+
+  external blit_to_bytes : Image.data8 -> int -> Bytes.t -> int -> unit
+    = "caml_cairo_png_blit_to_bytes" [@@noalloc]
+
+  (* The PNG stays outside the OCaml heap and is appended to [b] by
+     chunks, so no string of its size is allocated. *)
+  let write_to_buffer surf b =
+    let png = write_to_bigarray surf in
+    let len = Bigarray.Array1.dim png in
+    let chunk = Bytes.create (min len 65536) in
+    let ofs = ref 0 in
+    while !ofs < len do
+      let n = min (len - !ofs) (Bytes.length chunk) in
+      blit_to_bytes png !ofs chunk n;
+      Buffer.add_subbytes b chunk 0 n;
+      ofs := !ofs + n
+    done
 end
 
 module PS =
@@ -929,6 +1487,38 @@ struct
 
   external ink_extents : Surface.t -> rectangle
     = "caml_cairo_recording_surface_ink_extents"
+
+  external replay_stub : Surface.t -> Matrix.t option -> rectangle option ->
+                         context -> unit
+    = "caml_cairo_recording_surface_replay"
+
+  let replay surf ?matrix ?clip cr = replay_stub surf matrix clip cr
+
+  let inter r1 r2 =
+    let x = max r1.x r2.x and y = max r1.y r2.y in
+    { x;  y;  w = max 0. (min (r1.x +. r1.w) (r2.x +. r2.w) -. x);
+      h = max 0. (min (r1.y +. r1.h) (r2.y +. r2.h) -. y) }
+
+  (* Bounding box of the image of the rectangle [r] by [f]. *)
+  let bbox f r =
+    let x1, y1 = f r.x r.y and x2, y2 = f (r.x +. r.w) r.y in
+    let x3, y3 = f r.x (r.y +. r.h) and x4, y4 = f (r.x +. r.w) (r.y +. r.h) in
+    let x = min (min x1 x2) (min x3 x4) and y = min (min y1 y2) (min y3 y4) in
+    { x;  y;  w = max (max x1 x2) (max x3 x4) -. x;
+      h = max (max y1 y2) (max y3 y4) -. y }
+
+  let replay_extents surf ?matrix ?clip () =
+    let r = ink_extents surf in
+    let r = match clip with Some c -> inter r c | None -> r in
+    match matrix with
+    | Some m -> bbox (Matrix.transform_point m) r
+    | None -> r
+
+  external user_to_device : context -> float -> float -> float * float
+    = "caml_cairo_user_to_device"
+
+  let replay_device_extents surf ?matrix ?clip cr =
+    bbox (user_to_device cr) (replay_extents surf ?matrix ?clip ())
 end
 
 
@@ -939,6 +1529,9 @@ struct
   type 'a t = 'a pattern
   type any = any_pattern
 
+  external destroy : 'a t -> unit = "caml_cairo_pattern_destroy" [@@noalloc]
+  let with_pattern pat f = with_destroy destroy pat f
+
   external add_color_stop_rgb_stub : [> `Gradient] t -> ofs:float ->
                                      float -> float -> float -> unit
     = "caml_cairo_pattern_add_color_stop_rgb" [@@noalloc]
@@ -977,6 +1570,15 @@ struct
   external get_surface : [`Surface] t -> Surface.t
     = "caml_cairo_pattern_get_surface"
 
+  external create_raster_source_stub :
+    content -> int -> int
+    -> (Surface.t -> int -> int -> int -> int -> Surface.t)
+    -> (Surface.t -> unit) option -> [`Raster_source] t
+    = "caml_cairo_pattern_create_raster_source"
+
+  let create_raster_source ?(content=COLOR_ALPHA) ~w ~h ?release acquire =
+    create_raster_source_stub content w h acquire release
+
   external create_linear : x0:float -> y0:float -> x1:float -> y1:float ->
     [`Linear | `Gradient] t = "caml_cairo_pattern_create_linear"
 
@@ -991,6 +1593,61 @@ struct
     float * float * float * float * float * float
     = "caml_cairo_pattern_get_radial_circles"
 
+  module Mesh =
+  struct
+    external create : unit -> [`Mesh] t = "caml_cairo_pattern_create_mesh"
+
+    external begin_patch : [> `Mesh] t -> unit
+      = "caml_cairo_mesh_pattern_begin_patch"
+    external end_patch : [> `Mesh] t -> unit
+      = "caml_cairo_mesh_pattern_end_patch"
+    external move_to : [> `Mesh] t -> float -> float -> unit
+      = "caml_cairo_mesh_pattern_move_to"
+    external line_to : [> `Mesh] t -> float -> float -> unit
+      = "caml_cairo_mesh_pattern_line_to"
+    external curve_to : [> `Mesh] t -> float -> float -> float -> float ->
+                        float -> float -> unit
+      = "caml_cairo_mesh_pattern_curve_to_bc"
+        "caml_cairo_mesh_pattern_curve_to"
+    external set_control_point : [> `Mesh] t -> int -> float -> float -> unit
+      = "caml_cairo_mesh_pattern_set_control_point"
+    external set_corner_color_rgba : [> `Mesh] t -> int ->
+                                     float -> float -> float -> float -> unit
+      = "caml_cairo_mesh_pattern_set_corner_color_rgba_bc"
+        "caml_cairo_mesh_pattern_set_corner_color_rgba"
+
+    let set_corner_color_rgb pat i r g b = set_corner_color_rgba pat i r g b 1.
+
+    external get_patch_count : [> `Mesh] t -> int
+      = "caml_cairo_mesh_pattern_get_patch_count"
+    external get_control_point : [> `Mesh] t -> int -> int -> float * float
+      = "caml_cairo_mesh_pattern_get_control_point"
+    external get_corner_color_rgba :
+      [> `Mesh] t -> int -> int -> float * float * float * float
+      = "caml_cairo_mesh_pattern_get_corner_color_rgba"
+
+    open Bigarray
+
+    external add_patches :
+      [> `Mesh] t -> int -> (float, float64_elt, c_layout) Array1.t ->
+      (float, float64_elt, c_layout) Array1.t -> unit
+      = "caml_cairo_mesh_pattern_add_patches"
+
+    let add_polygons fname sides pat pts colors =
+      let n = Array1.dim pts / (2 * sides) in
+      if Array1.dim pts <> 2 * sides * n then
+        invalid_arg(Printf.sprintf "Cairo.Pattern.Mesh.%s: the length of \
+                      the points is not a multiple of %d" fname (2 * sides));
+      if Array1.dim colors <> 4 * sides * n then
+        invalid_arg(Printf.sprintf "Cairo.Pattern.Mesh.%s: %d color \
+                      components expected" fname (4 * sides * n));
+      add_patches pat sides pts colors
+
+    let add_triangles pat pts colors =
+      add_polygons "add_triangles" 3 pat pts colors
+    let add_quads pat pts colors = add_polygons "add_quads" 4 pat pts colors
+  end
+
   type extend =
     | NONE
     | REPEAT
@@ -1021,6 +1678,70 @@ struct
   external get_matrix : 'a t -> Matrix.t = "caml_cairo_pattern_get_matrix"
 end
 
+(* ---------------------------------------------------------------------- *)
+
+module Region =
+struct
+  type t
+
+  type rectangle = { x: int;  y: int;  w: int;  h: int }
+
+  type overlap = IN | OUT | PART
+
+  external create : unit -> t = "caml_cairo_region_create"
+  external create_rectangle : rectangle -> t
+    = "caml_cairo_region_create_rectangle"
+  external of_rectangles : rectangle array -> t
+    = "caml_cairo_region_create_rectangles"
+  external copy : t -> t = "caml_cairo_region_copy"
+
+  external extents : t -> rectangle = "caml_cairo_region_get_extents"
+  external num_rectangles : t -> int = "caml_cairo_region_num_rectangles"
+  external unsafe_get_rectangle : t -> int -> rectangle
+    = "caml_cairo_region_get_rectangle"
+
+  let get_rectangle r i =
+    if i < 0 || i >= num_rectangles r then
+      invalid_arg "Cairo.Region.get_rectangle: index out of bounds";
+    unsafe_get_rectangle r i
+
+  let iter f r =
+    for i = 0 to num_rectangles r - 1 do f (unsafe_get_rectangle r i) done
+
+  let fold f r a =
+    let a = ref a in
+    for i = 0 to num_rectangles r - 1 do a := f !a (unsafe_get_rectangle r i)
+    done;
+    !a
+
+  let to_array r = Array.init (num_rectangles r) (unsafe_get_rectangle r)
+
+  external is_empty : t -> bool = "caml_cairo_region_is_empty"
+  external contains_point : t -> int -> int -> bool
+    = "caml_cairo_region_contains_point"
+  external contains_rectangle : t -> rectangle -> overlap
+    = "caml_cairo_region_contains_rectangle"
+  external equal : t -> t -> bool = "caml_cairo_region_equal"
+
+  external translate : t -> int -> int -> unit
+    = "caml_cairo_region_translate"
+  external union : t -> t -> unit = "caml_cairo_region_union"
+  external union_rectangle : t -> rectangle -> unit
+    = "caml_cairo_region_union_rectangle"
+  external intersect : t -> t -> unit = "caml_cairo_region_intersect"
+  external intersect_rectangle : t -> rectangle -> unit
+    = "caml_cairo_region_intersect_rectangle"
+  external subtract : t -> t -> unit = "caml_cairo_region_subtract"
+  external subtract_rectangle : t -> rectangle -> unit
+    = "caml_cairo_region_subtract_rectangle"
+  external xor : t -> t -> unit = "caml_cairo_region_xor"
+  external xor_rectangle : t -> rectangle -> unit
+    = "caml_cairo_region_xor_rectangle"
+
+  external clip : context -> t -> unit = "caml_cairo_region_clip"
+  external mark_dirty : Surface.t -> t -> unit = "caml_cairo_region_mark_dirty"
+end
+
 (* ---------------------------------------------------------------------- *)
 (* Transformations - Manipulating the current transformation matrix  *)
 
@@ -1048,3 +1769,271 @@ external device_to_user : context -> float -> float -> float * float
 external device_to_user_distance :
   context -> float -> float -> float * float
   = "caml_cairo_device_to_user_distance"
+
+external user_to_device_points_stub :
+  context -> Matrix.points -> Matrix.points -> unit
+  = "caml_cairo_user_to_device_points" [@@noalloc]
+external user_to_device_distances_stub :
+  context -> Matrix.points -> Matrix.points -> unit
+  = "caml_cairo_user_to_device_distances" [@@noalloc]
+external device_to_user_points_stub :
+  context -> Matrix.points -> Matrix.points -> unit
+  = "caml_cairo_device_to_user_points" [@@noalloc]
+external device_to_user_distances_stub :
+  context -> Matrix.points -> Matrix.points -> unit
+  = "caml_cairo_device_to_user_distances" [@@noalloc]
+
+let user_to_device_points cr ?dst src =
+  user_to_device_points_stub cr src
+    (Matrix.check_points "user_to_device_points" ?dst src)
+
+let user_to_device_distances cr ?dst src =
+  user_to_device_distances_stub cr src
+    (Matrix.check_points "user_to_device_distances" ?dst src)
+
+let device_to_user_points cr ?dst src =
+  device_to_user_points_stub cr src
+    (Matrix.check_points "device_to_user_points" ?dst src)
+
+let device_to_user_distances cr ?dst src =
+  device_to_user_distances_stub cr src
+    (Matrix.check_points "device_to_user_distances" ?dst src)
+
+
+(* ---------------------------------------------------------------------- *)
+(* Rendering large images by tiles *)
+
+module Tiled =
+struct
+  external create_tile : Surface.t -> int -> int -> int -> int -> Surface.t
+    = "caml_cairo_image_surface_create_for_tile"
+
+  let sequential tasks = List.iter (fun f -> f ()) tasks
+
+  let render ?(tile=256) ?(run=sequential) target draw =
+    if tile <= 0 then invalid_arg "Cairo.Tiled.render: tile <= 0";
+    let w = Image.get_width target and h = Image.get_height target in
+    (* A multiple of 32 pixels keeps the tiles aligned whatever the
+       format of the image. *)
+    let tile_w = (tile + 31) land (lnot 31) in
+    let draw_tile x y w h () =
+      let surf = create_tile target x y w h in
+      let cr = create surf in
+      rectangle cr (float x) (float y) ~w:(float w) ~h:(float h);
+      clip cr;
+      draw cr;
+      Surface.finish surf in
+    let tasks = ref [] in
+    let y = ref 0 in
+    while !y < h do
+      let th = min tile (h - !y) in
+      let x = ref 0 in
+      while !x < w do
+        let tw = min tile_w (w - !x) in
+        tasks := draw_tile !x !y tw th :: !tasks;
+        x := !x + tw
+      done;
+      y := !y + th
+    done;
+    Surface.flush target;
+    run (List.rev !tasks);
+    Surface.mark_dirty target
+
+  let replay ?tile ?run target src =
+    render ?tile ?run target (fun cr ->
+        set_source_surface cr src ~x:0. ~y:0.;
+        paint cr)
+end
+
+
+(* ---------------------------------------------------------------------- *)
+(* Caching the rasterization of recording surfaces *)
+
+module Raster_cache =
+struct
+  type key = Surface.t * float * float * float * float * rectangle option
+             * rectangle
+  (* recording, scale x and y, subpixel offset x and y, clip, part of
+     the raster space (see [visible]) *)
+
+  (* Doubly linked list of the rasters, most recently used first. *)
+  type entry = {
+    key : key option; (* None for the sentinel *)
+    raster : Surface.t;
+    px : float; (* position of the raster w.r.t. the integer part *)
+    py : float; (* of the translation of the CTM *)
+    bytes : int;
+    mutable prev : entry;
+    mutable next : entry;
+  }
+
+  type t = {
+    budget : int;
+    subpixel : float;
+    rasters : (key, entry) Hashtbl.t;
+    lru : entry; (* sentinel *)
+    mutable used : int; (* bytes *)
+    mutable hits : int;
+    mutable misses : int;
+    mutable evictions : int;
+  }
+
+  (* Rasters only cover the part of the recording visible through the
+     clip of the target, enlarged to a grid of [clip_tile] pixels so
+     that they are reused while panning by small amounts. *)
+  let clip_tile = 256.
+
+  (* Largest width and height of an image surface. *)
+  let max_size = 32767
+
+  (* Part of the raster space (device space translated by minus the
+     integer part ([ix], [iy]) of the translation of the CTM) that
+     covers the device clip [dclip]. *)
+  let visible dclip ix iy =
+    let lo t = floor(t /. clip_tile) *. clip_tile
+    and hi t = ceil(t /. clip_tile) *. clip_tile in
+    let x = lo(dclip.x -. ix) and y = lo(dclip.y -. iy) in
+    { x;  y;  w = hi(dclip.x +. dclip.w -. ix) -. x;
+      h = hi(dclip.y +. dclip.h -. iy) -. y }
+
+  (* Pixel-aligned part of [visible] where the part of [recording]
+     within [clip] is drawn by a CTM whose linear part is the scaling
+     ([sx], [sy]) and whose translation has fractional part ([fx],
+     [fy]). *)
+  let extents recording ?clip visible sx sy fx fy =
+    let r = Recording.replay_extents recording ?clip () in
+    let x = max visible.x (floor(sx *. r.x +. fx))
+    and y = max visible.y (floor(sy *. r.y +. fy)) in
+    let w = min (visible.x +. visible.w) (ceil(sx *. (r.x +. r.w) +. fx))
+    and h = min (visible.y +. visible.h) (ceil(sy *. (r.y +. r.h) +. fy)) in
+    { x;  y;  w = max 0. (w -. x);  h = max 0. (h -. y) }
+
+  (* Render the part [r] (see [extents]) of [recording] to a new raster.
+     Defined before [create] is shadowed. *)
+  let rasterize cr recording ?clip key r sx sy fx fy =
+    let w = truncate r.w and h = truncate r.h in
+    let raster = Surface.create_similar (get_target cr) COLOR_ALPHA ~w ~h in
+    let cr' = create raster in
+    translate cr' (fx -. r.x) (fy -. r.y);
+    scale cr' sx sy;
+    Recording.replay recording ?clip cr';
+    destroy cr';
+    let rec e = { key = Some key;  raster;  px = r.x;  py = r.y;
+                  bytes = 4 * w * h;  prev = e;  next = e } in
+    e
+
+  let create ?(budget=64 * 1024 * 1024) ?(subpixel=4) () =
+    if budget < 0 then invalid_arg "Cairo.Raster_cache.create: budget < 0";
+    if subpixel <= 0 then
+      invalid_arg "Cairo.Raster_cache.create: subpixel <= 0";
+    let raster = Recording.create COLOR_ALPHA in
+    let rec lru = { key = None;  raster;  px = 0.;  py = 0.;  bytes = 0;
+                    prev = lru;  next = lru } in
+    { budget;  subpixel = float subpixel;  rasters = Hashtbl.create 64;
+      lru;  used = 0;  hits = 0;  misses = 0;  evictions = 0 }
+
+  let unlink e =
+    e.prev.next <- e.next;
+    e.next.prev <- e.prev
+
+  let push_front c e =
+    e.next <- c.lru.next;
+    e.prev <- c.lru;
+    c.lru.next.prev <- e;
+    c.lru.next <- e
+
+  (* Keys hash their recording by its C pointer, which
+     [Surface.destroy] changes, so [e] may no longer be found under
+     its key; it is then removed by physical identity. *)
+  let remove_binding c e =
+    Hashtbl.filter_map_inplace
+      (fun _ e' -> if e' == e then None else Some e') c.rasters
+
+  let remove c e =
+    unlink e;
+    (match e.key with
+     | Some k ->
+        (match Hashtbl.find c.rasters k with
+         | e' when e' == e -> Hashtbl.remove c.rasters k
+         | _ -> remove_binding c e
+         | exception Not_found -> remove_binding c e)
+     | None -> assert false);
+    c.used <- c.used - e.bytes;
+    Surface.destroy e.raster
+
+  let evict c =
+    while c.used > c.budget do
+      remove c c.lru.prev;
+      c.evictions <- c.evictions + 1
+    done
+
+  let clear c =
+    while c.lru.next != c.lru do remove c c.lru.next done
+
+  let invalidate c recording =
+    let cur = ref c.lru.next in
+    while !cur != c.lru do
+      let e = !cur in
+      cur := e.next;
+      match e.key with
+      | Some (r, _, _, _, _, _, _) when r == recording -> remove c e
+      | _ -> ()
+    done
+
+  let length c = Hashtbl.length c.rasters
+  let size c = c.used
+  let hits c = c.hits
+  let misses c = c.misses
+  let evictions c = c.evictions
+
+  (* Integer part and fractional part rounded to [1 / c.subpixel]. *)
+  let split c t =
+    let i = floor t in
+    let f = floor((t -. i) *. c.subpixel +. 0.5) in
+    if f >= c.subpixel then (i +. 1., 0.) else (i, f /. c.subpixel)
+
+  let paint_raster cr e ix iy =
+    set_source_surface cr e.raster ~x:(ix +. e.px) ~y:(iy +. e.py);
+    paint cr
+
+  let replay c recording ?clip cr =
+    let m = get_matrix cr in
+    if m.xy <> 0. || m.yx <> 0. || m.xx <= 0. || m.yy <= 0. then
+      (* Rotations and reflections are not cached. *)
+      Recording.replay recording ?clip cr
+    else (
+      let ix, fx = split c m.x0 and iy, fy = split c m.y0 in
+      save cr;
+      identity_matrix cr;
+      let dclip = clip_extents cr in
+      let vis = visible dclip ix iy in
+      let key = (recording, m.xx, m.yy, fx, fy, clip, vis) in
+      match Hashtbl.find c.rasters key with
+      | e ->
+         c.hits <- c.hits + 1;
+         unlink e;
+         push_front c e;
+         paint_raster cr e ix iy;
+         restore cr
+      | exception Not_found ->
+         restore cr;
+         let r = extents recording ?clip vis m.xx m.yy fx fy in
+         let w = truncate r.w and h = truncate r.h in
+         if w > 0 && h > 0 then
+           if w > max_size || h > max_size || 4 * w * h > c.budget then
+             (* Not worth a raster that would not be kept. *)
+             Recording.replay recording ?clip cr
+           else (
+             c.misses <- c.misses + 1;
+             let e = rasterize cr recording ?clip key r m.xx m.yy fx fy in
+             push_front c e;
+             Hashtbl.add c.rasters key e;
+             c.used <- c.used + e.bytes;
+             evict c;
+             save cr;
+             identity_matrix cr;
+             paint_raster cr e ix iy;
+             restore cr
+           )
+    )
+end
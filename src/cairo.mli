@@ -22,11 +22,12 @@
     - {{!cairo_t}Cairo.context}: The cairo drawing context
     - {{!paths}Path}: Creating paths and manipulating path data
     - {!Pattern}: Sources for drawing.
-    - Regions — Representing a pixel-aligned area (TODO).
+    - {!Region}: Representing a pixel-aligned area.
     - {{!transformations}Transformations}: Manipulating the current
       transformation matrix.
     - {{!text}Text}: Rendering text and glyphs.
-    - Raster Sources — Supplying arbitrary image data (TODO).
+    - Raster Sources: Supplying arbitrary image data, see
+      {!Pattern.create_raster_source}.
 
     {b Fonts:}
     - {!Font_face}: Base module for font faces.
@@ -56,6 +57,29 @@
     you read the {{:http://archimedes.forge.ocamlcore.org/cairo/}
     Cairo OCaml tutorial}.
 
+    {b Threads:} the functions doing the actual rendering, namely
+    {!Cairo.fill}, {!Cairo.fill_preserve}, {!Cairo.stroke},
+    {!Cairo.stroke_preserve}, {!Cairo.paint}, {!Cairo.paint_with_alpha},
+    {!Cairo.mask}, {!Cairo.mask_surface}, {!Cairo.show_glyphs},
+    {!Cairo.show_page}, {!Cairo.copy_page}, {!Cairo.Surface.finish},
+    {!Cairo.Surface.show_page}, {!Cairo.Surface.copy_page},
+    {!Cairo.Image.map}, {!Cairo.Image.map_data32},
+    {!Cairo.PNG.write}, {!Cairo.PNG.write_to_string},
+    {!Cairo.PNG.write_to_buffer}, {!Cairo.PNG.write_to_bigarray},
+    {!Cairo.PNG.of_bigarray}, {!Cairo.Glyph.Buffer.show},
+    {!Cairo.Scaled_font.Cache.show_text}, {!Cairo.in_fill_many},
+    {!Cairo.in_stroke_many}, {!Cairo.in_clip_many} and
+    {!Cairo.Recording.replay}, release the OCaml runtime lock while
+    Cairo works, so other threads can run in the meantime.  The data
+    they need (including the bigarray of an image surface) is kept
+    alive during the call.  This is not the case when the target
+    surface writes to an OCaml function
+    (e.g. {!Cairo.PDF.create_for_stream}) since it must then call
+    back OCaml.  The callbacks of {!Cairo.Pattern.create_raster_source}
+    take the lock back while they run.  Note that a context (and its
+    target surface) must not be used by several threads at the same
+    time.
+
     @author Christophe Troestler
     @version %%VERSION%%
 *)
@@ -203,6 +227,26 @@ sig
   val transform_point : t -> float -> float -> float * float
   (** [transform_point matrix x y] transforms the point ([x], [y]) by
      [matrix]. *)
+
+  type points =
+    (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t
+  (** Points (or distance vectors) stored as
+     [[| x0; y0; x1; y1;... |]], the layout used by
+     {!Cairo.Path.lines_of_bigarray}. *)
+
+  val transform_points : t -> ?dst: points -> points -> unit
+  (** [transform_points matrix points] transforms all the [points] by
+     [matrix] in place.  If [dst] is given, the transformed points are
+     written to it instead and [points] is left untouched.  This is
+     equivalent to, but much faster than, calling
+     {!Cairo.Matrix.transform_point} on each point.
+     @raise Invalid_argument if [points] has an odd length or [dst]
+     has not the same length as [points]. *)
+
+  val transform_distances : t -> ?dst: points -> points -> unit
+  (** [transform_distances matrix v] transforms all the distance
+     vectors [v] by [matrix].  See {!Cairo.Matrix.transform_distance}
+     and {!Cairo.Matrix.transform_points}. *)
 end
 
 (* ---------------------------------------------------------------------- *)
@@ -333,6 +377,92 @@ sig
      backward.
 
      See {!Cairo.Glyph.cluster} for constraints on valid clusters. *)
+
+  type glyph = t
+  (** Alias for {!Cairo.Glyph.t} (to refer to it in {!Buffer}). *)
+
+  (** Growable arrays of glyphs stored outside the OCaml heap in the
+      form Cairo uses.  They can be passed to Cairo without any
+      conversion and be reused (e.g. from one frame to the next)
+      instead of allocating a new {!Cairo.Glyph.t} array each time.
+      A buffer also holds the clusters mapping its glyphs to the text
+      when it is filled by {!Scaled_font.text_to_glyph_buffer}. *)
+  module Buffer : sig
+    type t
+
+    val create : ?size:int -> unit -> t
+    (** [create ()] returns a new empty buffer.
+        @param size the number of glyphs the buffer can hold before it
+        needs to grow (default: [64]). *)
+
+    val length : t -> int
+    (** [length b] returns the number of glyphs in [b]. *)
+
+    val clear : t -> unit
+    (** [clear b] removes all glyphs and clusters from [b] (the memory
+        is kept for reuse). *)
+
+    val add : t -> int -> float -> float -> unit
+    (** [add b index x y] appends the glyph with the given index and
+        offsets to [b].  In native code, this allocates nothing in the
+        OCaml heap (except when [b] grows). *)
+
+    val set : t -> int -> index:int -> x:float -> y:float -> unit
+    (** [set b i ~index ~x ~y] replaces the [i]th glyph of [b].
+        @raise Invalid_argument if [i] is not a valid index. *)
+
+    val get : t -> int -> glyph
+    (** [get b i] returns the [i]th glyph of [b].
+        @raise Invalid_argument if [i] is not a valid index. *)
+
+    val get_index : t -> int -> int
+    (** [get_index b i] is [(get b i).index] without allocation. *)
+
+    val get_x : t -> int -> float
+    (** [get_x b i] is [(get b i).x] without allocation. *)
+
+    val get_y : t -> int -> float
+    (** [get_y b i] is [(get b i).y] without allocation. *)
+
+    val of_array : glyph array -> t
+    (** [of_array glyphs] returns a new buffer holding [glyphs]. *)
+
+    val to_array : t -> glyph array
+    (** [to_array b] returns the glyphs of [b]. *)
+
+    val num_clusters : t -> int
+    (** [num_clusters b] returns the number of clusters in [b]. *)
+
+    val get_cluster : t -> int -> cluster
+    (** [get_cluster b i] returns the [i]th cluster of [b].
+        @raise Invalid_argument if [i] is not a valid index. *)
+
+    val get_cluster_bytes : t -> int -> int
+    (** [get_cluster_bytes b i] is [(get_cluster b i).num_bytes]
+        without allocation. *)
+
+    val get_cluster_glyphs : t -> int -> int
+    (** [get_cluster_glyphs b i] is [(get_cluster b i).num_glyphs]
+        without allocation. *)
+
+    val backward : t -> bool
+    (** [backward b] says whether the clusters of [b] map to the glyphs
+        from end to start (see {!cluster_flags}). *)
+
+    val show : context -> t -> unit
+    (** Same as {!Cairo.Glyph.show} for the glyphs of the buffer. *)
+
+    val show_text : context -> string -> t -> unit
+    (** [show_text cr utf8 b] same as {!Cairo.Glyph.show_text} with the
+        glyphs and clusters of [b] (typically obtained from [utf8]
+        with {!Scaled_font.text_to_glyph_buffer}). *)
+
+    val path : context -> t -> unit
+    (** Same as {!Cairo.Path.glyph} for the glyphs of the buffer. *)
+
+    val extents : context -> t -> text_extents
+    (** Same as {!Cairo.Glyph.extents} for the glyphs of the buffer. *)
+  end
 end
 
 
@@ -712,6 +842,18 @@ sig
      used to render later using [scaled_font].  See
      {!Cairo.Glyph.show_text}. *)
 
+  val text_to_glyph_buffer : _ t -> x:float -> y:float -> string ->
+                             Glyph.Buffer.t -> int
+  (** [text_to_glyph_buffer scaled_font x y utf8 b] same as
+     {!text_to_glyphs} except that the glyphs and clusters replace the
+     content of [b], and the number of glyphs is returned.  Cairo
+     writes them directly into [b] (which grows if needed), so
+     reusing [b] for many strings allocates nothing in the OCaml
+     heap. *)
+
+  val glyph_buffer_extents : _ t -> Glyph.Buffer.t -> text_extents
+  (** Same as {!glyph_extents} for the glyphs of a buffer. *)
+
   val get_font_face : 'a t -> 'a Font_face.t
   (** Gets the font face that this scaled font was created for. *)
 
@@ -736,6 +878,49 @@ sig
   val get_type : 'a t -> font_type
   (** This function returns the type of the backend used to create a
      scaled font.  See {!Cairo.font_type} for available types. *)
+
+  type 'a scaled_font = 'a t
+  (** Alias for {!Cairo.Scaled_font.t} (to refer to it in {!Cache}). *)
+
+  (** Cache of the glyph runs of strings, to avoid shaping again and
+      again the strings that are drawn repeatedly (labels, legends,...).
+      Runs are keyed by the scaled font (physical identity of the
+      underlying Cairo object) and the UTF-8 string.  When the cache is
+      full, the least recently used run is discarded.  A cache keeps
+      the scaled fonts of its runs alive. *)
+  module Cache : sig
+    type 'a t
+
+    val create : ?size:int -> unit -> 'a t
+    (** [create ()] returns a new empty cache.
+        @param size the maximum number of runs kept (default: [1024]). *)
+
+    val find : 'a t -> 'a scaled_font -> string -> Glyph.Buffer.t
+    (** [find cache sf utf8] returns the glyphs and clusters of [utf8]
+        for [sf], positioned relative to the origin (as
+        [text_to_glyph_buffer sf ~x:0. ~y:0. utf8] would).  The buffer
+        belongs to the cache and must not be modified. *)
+
+    val show_text : 'a t -> context -> string -> unit
+    (** [show_text cache cr utf8] same as {!Cairo.show_text} but the
+        glyph run of [utf8] for the current scaled font of [cr] (see
+        {!Cairo.Scaled_font.get}) is taken from [cache]. *)
+
+    val length : 'a t -> int
+    (** [length cache] returns the number of runs in [cache]. *)
+
+    val hits : 'a t -> int
+    (** [hits cache] returns the number of lookups of runs already in
+        [cache]. *)
+
+    val misses : 'a t -> int
+    (** [misses cache] returns the number of lookups that had to shape
+        the text. *)
+
+    val clear : 'a t -> unit
+    (** [clear cache] removes all runs from [cache] (the counters are
+        kept). *)
+  end
 end
 
 
@@ -937,6 +1122,38 @@ sig
      Initially the surface contents are all 0 (transparent if contents
      have transparency, black otherwise.) *)
 
+  val create_for_rectangle : t -> x:float -> y:float -> w:float -> h:float
+                             -> t
+  (** [create_for_rectangle target x y w h] creates a surface that is a
+     view of the rectangle of [target] with top left corner ([x],[y])
+     and size [w]×[h], in device-space units of [target].  No pixel is
+     copied: drawing on the view draws on [target] (clipped to the
+     rectangle, with the origin at ([x],[y])), and using the view as
+     a source (e.g. with {!Cairo.set_source_surface}) reads the pixels
+     of [target].  This is convenient, for example, to draw a single
+     icon of a sprite sheet.
+
+     The view keeps [target] alive (including the pixels of an image
+     surface created from a bigarray, even if [target] is finished).
+     Requires Cairo 1.10.
+     @raise Unavailable if the Cairo version is older. *)
+
+  val destroy : t -> unit
+  (** [destroy surf] drops the reference [surf] holds on the surface
+     immediately instead of waiting for the GC to do it.  The surface
+     (and its memory) is released when no context or pattern use it
+     any more; call {!finish} before if you want its output to be
+     complete at this point.  Afterwards, [surf] behaves as an empty
+     finished surface (see {!finish}); using it as a source or a mask
+     raises [Error SURFACE_FINISHED] and leaves the context as it
+     was. *)
+
+  val with_surface : t -> (t -> 'a) -> 'a
+  (** [with_surface surf f] returns [f surf] and destroys [surf] when
+     [f] returns or raises.  For example, the memory of a temporary
+     image is released as soon as [f] is done with
+     [Surface.with_surface (Image.create Image.ARGB32 ~w ~h) f]. *)
+
   val finish : t -> unit
   (** This function finishes the surface and drops all references to
      external resources. For example, for the Xlib backend it means
@@ -1057,7 +1274,17 @@ sig
       | `OS2
       | `Win32_printing
       | `Quartz_image
+      | `Script
+      | `Qt
       | `Recording
+      | `VG
+      | `GL
+      | `DRM
+      | `Tee
+      | `XML
+      | `Skia
+      | `Subsurface
+      | `Cogl
       ]
 
   val get_type : t -> kind
@@ -1093,6 +1320,92 @@ sig
      succeed.  It just will act like a {!Cairo.Glyph.show} operation.
      Users can use this function to avoid computing UTF-8 text and
      cluster mapping if the target surface does not use it.  *)
+
+  (** {3 MIME data}
+
+     An image may carry its original encoded form (e.g. the JPEG file
+     it was decoded from).  When the image is used as a source on a
+     {!Cairo.PDF}, {!Cairo.PS} or {!Cairo.SVG} surface, the backend
+     embeds these bytes directly instead of re-encoding the pixels,
+     which is faster and gives smaller files.  Each backend only uses
+     the MIME types it understands (see
+     {!Cairo.Surface.supports_mime_type}); the pixels remain used
+     everywhere else, so they must match the encoded data. *)
+
+  (** Standard MIME types. *)
+  module Mime :
+  sig
+    val jpeg : string
+    (** ["image/jpeg"], a JPEG image. *)
+
+    val png : string
+    (** ["image/png"], a PNG image. *)
+
+    val jp2 : string
+    (** ["image/jp2"], a JPEG 2000 image. *)
+
+    val uri : string
+    (** ["text/x-uri"], a URI referencing the image (used by the SVG
+       backend to link to the image instead of embedding it). *)
+
+    val unique_id : string
+    (** ["application/x-cairo.uuid"], an identifier unique to the
+       image.  Surfaces with the same unique ID are embedded only
+       once in a PDF or PS document, even if they are different
+       surfaces (e.g. an image loaded several times).  Requires Cairo
+       1.12 to be taken into account. *)
+
+    val jbig2 : string
+    (** ["application/x-cairo.jbig2"], a JBIG2 embedded stream
+       (Cairo >= 1.14). *)
+
+    val jbig2_global : string
+    (** ["application/x-cairo.jbig2-global"], the global segment of
+       JBIG2 streams sharing it (Cairo >= 1.14). *)
+
+    val jbig2_global_id : string
+    (** ["application/x-cairo.jbig2-global-id"], an identifier
+       associating a JBIG2 stream with its global segment
+       (Cairo >= 1.14). *)
+  end
+
+  val set_mime_data : t -> string -> string -> unit
+  (** [set_mime_data surface mime_type data] attaches [data], the
+     encoding of the image in the format [mime_type] (for example
+     {!Cairo.Surface.Mime.jpeg}), to [surface], replacing any data previously
+     attached for [mime_type].  [data] is copied.  The MIME data is
+     discarded as soon as the surface is drawn on.
+     Requires Cairo 1.10.
+     @raise Unavailable if the Cairo version is older. *)
+
+  val set_mime_data_bigarray :
+    t -> string ->
+    (int, Bigarray.int8_unsigned_elt, Bigarray.c_layout) Bigarray.Array1.t ->
+    unit
+  (** [set_mime_data_bigarray surface mime_type data] is like
+     {!Cairo.Surface.set_mime_data} but shares [data] with the
+     surface instead of copying it (unless [data] is memory mapped or
+     external, in which case it is copied).  The content of [data]
+     must not be changed while [surface] holds it.  Requires Cairo
+     1.10.
+     @raise Unavailable if the Cairo version is older. *)
+
+  val remove_mime_data : t -> string -> unit
+  (** [remove_mime_data surface mime_type] detaches the data for
+     [mime_type] from [surface], if any.  Requires Cairo 1.10.
+     @raise Unavailable if the Cairo version is older. *)
+
+  val get_mime_data : t -> string -> string option
+  (** [get_mime_data surface mime_type] returns a copy of the data
+     attached to [surface] for [mime_type], if any.  Requires Cairo
+     1.10.
+     @raise Unavailable if the Cairo version is older. *)
+
+  val supports_mime_type : t -> string -> bool
+  (** [supports_mime_type surface mime_type] says whether [surface]
+     uses the data of [mime_type] attached to its source images.
+     Requires Cairo 1.12.
+     @raise Unavailable if the Cairo version is older. *)
 end
 
 (** {3:surface_backends   Surface backends}
@@ -1169,7 +1482,10 @@ sig
   (** Get the data of the image surface (shared), for direct
      inspection or modification. A call to {!Cairo.Surface.mark_dirty}
      or {!Cairo.Surface.mark_dirty_rectangle} is required after the
-     data is modified. *)
+     data is modified.  For the view of a part of an image (such as
+     the target of a tile of {!Tiled.render}), the array stops at the
+     last pixel of the image it is part of, so the last row may be
+     shorter than the stride. *)
 
   val get_data32 : Surface.t -> data32
   (** Get the data of the image surface (shared), for direct
@@ -1181,7 +1497,9 @@ sig
 
      @raise Invalid_argument if the format is not [ARGB32] or
      [RGB24] because the array dimensions would not reflect the image
-     coordinates.  *)
+     coordinates, or if the surface is the view of a part of an image
+     whose last row, padded to the stride, would extend past the
+     pixels of that image (use {!get_data8} instead).  *)
 
   val get_format : Surface.t -> format
   (** Get the format of the image surface. *)
@@ -1204,10 +1522,191 @@ sig
       all alignment requirements of the accelerated image-rendering code
       within cairo.  See {!create_for_data8}.  *)
 
+  val map : Surface.t -> ?x:int -> ?y:int -> ?w:int -> ?h:int ->
+            (Surface.t -> 'a) -> 'a
+  (** [map surface ~x ~y ~w ~h f] gives [f] an image surface holding
+     the pixels of the rectangle of [surface] with top left corner
+     ([x],[y]) (default [0]) and size [w]×[h] (in device units) and
+     returns the result of [f].  If [w] and [h] are omitted (as well
+     as [x] and [y]), the whole [surface] is mapped.  This works for
+     any surface, not only images: post-processing passes can read
+     and modify the pixels in place (see also {!map_data32}).  When
+     [f] returns (or raises), the pixels are written back to
+     [surface] and the image is released.  For image surfaces, no
+     copy is made: the image is a view of the pixels of [surface]
+     with the stride of [surface] (so {!get_data8} returns an array
+     stopping at the last pixel of [surface] and {!get_data32} may
+     refuse the image, see {!map_data32} instead).
+
+     [f] must neither finish nor destroy the image and must not keep
+     it, or any bigarray of its data, after returning (the image then
+     behaves as a destroyed surface, see {!Surface.destroy}).  The
+     format of the image is the one of [surface] if it is an image,
+     [ARGB32] or [RGB24] otherwise.  Requires Cairo 1.12.
+
+     @raise Invalid_argument if only one of [w] and [h] is given, or
+     if [x] or [y] are given without them.
+     @raise Unavailable if the Cairo version is older. *)
+
+  val map_data32 : Surface.t -> ?x:int -> ?y:int -> ?w:int -> ?h:int ->
+                   (data32 -> 'a) -> 'a
+  (** [map_data32 surface ~x ~y ~w ~h f] is like {!map} but gives [f]
+     the pixels directly, as a [h]×[w] array (see {!get_data32}).
+     The pixels of an image surface are shared unless the rows of the
+     rectangle are shorter than the ones of [surface], in which case
+     they are copied to and from a temporary image (the pixels are
+     written back whether [f] returns or raises).  The array is made
+     empty when [f] returns, so it cannot be used to access the
+     released pixels.  This is not the case of the sub-arrays and
+     slices taken from it (e.g. with [Bigarray.Array2.slice_left]):
+     they must not be used after [f] returns.
+
+     @raise Invalid_argument if the format of the mapped image is
+     not [ARGB32] or [RGB24] (see also {!map}).
+     @raise Unavailable if the Cairo version is older. *)
+
+  (** Formats in which the pixels of an image can be output. *)
+  type output_format =
+    | PPM (** Binary PPM (P6), the alpha channel is ignored. *)
+    | PAM (** Netpbm PAM (P7) with tuple type [RGB_ALPHA], thus with
+              non-premultiplied alpha. *)
+    | RGBA (** Raw pixels (no header), 4 bytes per pixel in the order
+               red, green, blue, alpha.  Alpha is premultiplied. *)
+    | BGRA (** Raw pixels (no header), 4 bytes per pixel in the order
+               blue, green, red, alpha.  Alpha is premultiplied.  On
+               little-endian machines, this is Cairo's own layout. *)
+
+  val output : out_channel -> output_format -> Surface.t -> unit
+  (** [output ch format surface] writes the pixels of the image
+     [surface] to [ch] in the given [format].  The image is converted
+     a row at a time into a buffer that is reused, so this is suitable
+     to feed the frames of a video to an encoder.  The alpha of [RGB24]
+     images is taken to be opaque.
+
+     @raise Invalid_argument if the format of [surface] is not
+     [ARGB32] or [RGB24]. *)
+
   val output_ppm : out_channel -> ?w:int -> ?h:int -> data32 -> unit
-  (** [output_ppm ch width height data] convenience function to write
-     the subarray of size ([width], [height]) representing an image to
-     the PPM format.  The possible alpha channel is ignored. *)
+  (** [output_ppm ch ?w ?h data] convenience function to write the
+     subarray of size ([w], [h]) representing an image to the PPM
+     format.  The possible alpha channel is ignored.
+
+     @param w the width of the image (default: [Array2.dim2 data]).
+     @param h the height of the image (default: [Array2.dim1 data]). *)
+
+  (** {3 Pixel conversions}
+
+     The following functions convert pixels with C loops, without
+     going through Cairo's compositing (which is much faster than
+     converting them in OCaml).  Their [surface] arguments must be
+     image surfaces. *)
+
+  val convert : Surface.t -> Surface.t -> unit
+  (** [convert src dst] copies the pixels of [src] to [dst], which
+     must have the same width and height but may have different
+     strides, converting them between the formats [ARGB32], [RGB24]
+     and [A8]: an [RGB24] image is opaque, dropping the alpha of an
+     [ARGB32] image amounts to compositing it over black, and [A8]
+     pixels become black with the same alpha.  [A1] images can only
+     be copied to [A1] images.  Other formats are not supported.
+
+     @raise Invalid_argument if the images do not satisfy these
+     conditions. *)
+
+  type channel_order = [ `RGBA | `BGRA | `ARGB | `ABGR ]
+  (** The order of the channels of a pixel stored in 4 bytes.  For
+     example [`RGBA] is the order of OpenGL's [GL_RGBA] and of the
+     HTML canvas. *)
+
+  val convert_to_data8 : Surface.t -> ?order:channel_order ->
+                         ?premultiplied:bool -> ?stride:int -> data8 -> unit
+  (** [convert_to_data8 surface data] writes the pixels of the
+     [ARGB32] or [RGB24] image [surface] to [data], 4 bytes per pixel
+     in the given [order] (default [`RGBA]), rows being [stride] bytes
+     apart (default: 4 times the width of [surface]).  The alpha is
+     straight (the colours are not multiplied by it) unless
+     [premultiplied] is [true] (default [false]).  The alpha of
+     [RGB24] images is 255.
+
+     @raise Invalid_argument if [surface] has an other format, if
+     [stride] is smaller than 4 times the width or if [data] is too
+     small. *)
+
+  val convert_of_data8 : data8 -> ?order:channel_order ->
+                         ?premultiplied:bool -> ?stride:int -> Surface.t -> unit
+  (** [convert_of_data8 data surface] is the inverse of
+     {!convert_to_data8}: it replaces the pixels of the [ARGB32] or
+     [RGB24] image [surface] by the ones in [data].  For [RGB24]
+     images, pixels that are not opaque are composited over black. *)
+
+  val premultiply : data32 -> unit
+  (** [premultiply data] multiplies the colour channels of the
+     [ARGB32] pixels of [data] by their alpha (converting the pixels
+     from straight alpha, e.g. as produced by image decoders, to the
+     representation used by Cairo).  Call {!Cairo.Surface.mark_dirty}
+     if [data] belongs to a surface. *)
+
+  val unpremultiply : data32 -> unit
+  (** [unpremultiply data] is the inverse of {!premultiply} (up to
+     rounding): the colour channels are divided by the alpha, except
+     for fully transparent pixels, and saturate at 255.  Call
+     {!Cairo.Surface.flush} before if [data] belongs to a surface and
+     {!Cairo.Surface.mark_dirty} after if it is still used with Cairo
+     (whose pixels must be premultiplied). *)
+
+  (** Recycling the pixel buffers of image surfaces.
+
+     Creating an image with {!Cairo.Image.create} allocates and clears
+     a new buffer for its pixels.  Programs creating many images of
+     the same few sizes (e.g. the frames of an animation or
+     thumbnails) can instead get them from a pool: when an image of
+     the pool is released (by the GC, {!Cairo.Surface.destroy} or
+     {!Cairo.Surface.finish}) and no longer used by Cairo, its buffer
+     returns to the pool to be used by the next image needing a
+     buffer of the same size (in bytes, so e.g. [ARGB32] and [RGB24]
+     images of the same dimensions share buffers).  A pool may be
+     shared by several threads. *)
+  module Pool :
+  sig
+    type t
+    (** A pool of pixel buffers. *)
+
+    val create : ?budget:int -> unit -> t
+    (** [create ()] returns a new pool.  The buffers returned to the
+       pool are kept as long as their total size does not exceed
+       [budget] bytes (default: 64 MB); others are freed.
+       @raise Invalid_argument if [budget < 0]. *)
+
+    val create_image : t -> ?zeroed:bool -> format -> w:int -> h:int ->
+                       Surface.t
+    (** [create_image pool format ~w ~h] is like
+       {!Cairo.Image.create} but reuses a buffer of [pool] if one of
+       the right size is available.  If [zeroed] is [false] (default:
+       [true]), the pixels of a reused buffer are not cleared: they
+       are the ones of the previous image, which is faster if the
+       image is going to be painted over entirely.
+
+       The buffer of an image whose pixels were accessed with
+       {!Cairo.Image.get_data8} or {!Cairo.Image.get_data32} is not
+       returned to the pool (it is freed with the last bigarray or
+       image using it).
+       @raise Error if [w] or [h] is negative ([INVALID_SIZE]). *)
+
+    val clear : t -> unit
+    (** [clear pool] frees the buffers currently held by [pool]. *)
+
+    val size : t -> int
+    (** [size pool] returns the total size (in bytes) of the buffers
+       held by [pool]. *)
+
+    val hits : t -> int
+    (** [hits pool] returns the number of images created with a buffer
+       of [pool]. *)
+
+    val misses : t -> int
+    (** [misses pool] returns the number of images for which a new
+       buffer had to be allocated. *)
+  end
 end
 
 (** The PDF surface is used to render cairo graphics to Adobe PDF
@@ -1272,12 +1771,44 @@ sig
      [s] whose first [l] bytes must be filled with PNG data.  Any
      exception raised by [input] is considered as a read error.  *)
 
+  val of_string : string -> Surface.t
+  (** [of_string s] creates a new image surface from the PNG data [s]
+     (e.g. the body of an HTTP response).  The data is read directly
+     from [s], without calling OCaml functions.
+
+     @raise Error if [s] is not valid PNG data. *)
+
+  val of_bigarray : Image.data8 -> Surface.t
+  (** [of_bigarray b] same as {!of_string} for PNG data held in a
+     bigarray (e.g. a memory mapped file).  The runtime lock is
+     released while decoding. *)
+
   val write : Surface.t -> string -> unit
   (** [write surface filename] writes the contents of [surface] to a
      new file [filename] as a PNG image. *)
 
   val write_to_stream : Surface.t -> (string -> unit) -> unit
-  (** Writes the image surface using the [output] function. *)
+  (** Writes the image surface using the [output] function.  A new
+     string is allocated for each chunk of data; if you want all the
+     data anyway, prefer the functions below. *)
+
+  val write_to_string : Surface.t -> string
+  (** [write_to_string surface] returns the PNG encoding of [surface].
+     The data is accumulated outside the OCaml heap and copied once
+     into the returned string.  The runtime lock is released while
+     encoding. *)
+
+  val write_to_buffer : Surface.t -> Buffer.t -> unit
+  (** [write_to_buffer surface b] appends the PNG encoding of
+     [surface] to [b].  The data is copied directly from the memory
+     Cairo wrote to (see {!write_to_bigarray}), no string holding the
+     whole encoding is allocated. *)
+
+  val write_to_bigarray : Surface.t -> Image.data8
+  (** [write_to_bigarray surface] returns the PNG encoding of
+     [surface] as a bigarray.  Contrarily to {!write_to_string}, the
+     data is not copied: the bigarray uses the memory Cairo wrote
+     to. *)
 end
 
 (** The PostScript surface is used to render cairo graphics to Adobe
@@ -1534,6 +2065,37 @@ sig
       surface.  This is useful to compute the required size of another
       drawing surface into which to replay the full sequence of drawing
       operations. *)
+
+  val replay : Surface.t -> ?matrix:Matrix.t -> ?clip:rectangle ->
+               context -> unit
+  (** [replay recording cr] paints the operations stored in the
+      [recording] surface on [cr], with the coordinates of the
+      recording interpreted in the user space of [cr] transformed by
+      [matrix] (default: identity).  If [clip] is given, only the part
+      of the recording within this rectangle (in the coordinates of
+      the recording) is replayed.  The state of [cr] (source, CTM,
+      current path,...) is left unchanged.
+
+      Unlike going through {!Cairo.set_source_surface} and
+      {!Cairo.paint}, no pattern is allocated on the OCaml side and
+      the OCaml runtime lock is released during the replay.  This is
+      meant to record static layers once and redraw them at each pan
+      and zoom.
+      @raise Invalid_argument if [clip] has a negative width or height.
+      @raise Unavailable if the recording surface is not available. *)
+
+  val replay_extents : Surface.t -> ?matrix:Matrix.t -> ?clip:rectangle ->
+                       unit -> rectangle
+  (** [replay_extents recording ()] returns a bounding box, in the user
+      space of the context, of what [replay recording ?matrix ?clip]
+      would draw.  It is based on {!ink_extents}. *)
+
+  val replay_device_extents : Surface.t -> ?matrix:Matrix.t ->
+                              ?clip:rectangle -> context -> rectangle
+  (** [replay_device_extents recording cr] is the same as
+      {!replay_extents} but in device space, that is the region of the
+      target of [cr] that [replay recording ?matrix ?clip cr] may
+      modify. *)
 end
 
 
@@ -1544,7 +2106,9 @@ end
     associated function. *)
 module Pattern :
 sig
-  type 'a t constraint 'a = [<`Solid | `Surface | `Gradient | `Linear | `Radial]
+  type 'a t
+  constraint 'a = [<`Solid | `Surface | `Gradient | `Linear | `Radial | `Mesh
+                  | `Raster_source]
   (** This is the paint with which cairo draws.  The primary use of
      patterns is as the source for all cairo drawing operations,
      although they can also be used as masks, that is, as the brush
@@ -1554,13 +2118,25 @@ sig
      of the form [Cairo.Pattern.create_type] or implicitly through
      [Cairo.set_source_*] functions.  *)
 
-  type any = [`Solid | `Surface | `Gradient | `Linear | `Radial] t
+  type any = [`Solid | `Surface | `Gradient | `Linear | `Radial | `Mesh
+             | `Raster_source] t
   (** {!Cairo.Group.pop} and {!Cairo.get_source} retrieve patterns
      whose properties we do not know.  In this case, we can only
      assume the pattern has potentially all properties and the
      functions below may raise an exception if it turns out that the
      needed property is not present. *)
 
+  val destroy : 'a t -> unit
+  (** [destroy pat] releases [pat] immediately instead of waiting for
+     the GC to do it.  The contexts using [pat] as their source keep
+     it alive as long as needed.  Any subsequent use of [pat] raises
+     [Error NULL_POINTER] (without putting the context it is used
+     with in error). *)
+
+  val with_pattern : 'a t -> ('a t -> 'b) -> 'b
+  (** [with_pattern pat f] returns [f pat] and destroys [pat] when [f]
+     returns or raises. *)
+
   val add_color_stop_rgb : [> `Gradient] t -> ?ofs:float ->
     float -> float -> float -> unit
   (** Adds an opaque color stop to a gradient pattern.  The offset
@@ -1629,6 +2205,41 @@ sig
   val get_surface : [`Surface] t -> Surface.t
   (** Gets the surface of a surface pattern.  *)
 
+  val create_raster_source :
+    ?content:content -> w:int -> h:int -> ?release:(Surface.t -> unit) ->
+    (Surface.t -> int -> int -> int -> int -> Surface.t) ->
+    [`Raster_source] t
+  (** [create_raster_source ~w ~h acquire] creates a pattern whose
+      pixels are supplied on demand: each time Cairo needs to sample
+      the pattern, it calls [acquire target x y w h], where [target]
+      is the surface being drawn on and ([x], [y], [w], [h]) is the
+      rectangle (in pattern space) that is needed (Cairo may request
+      the whole pattern).  [acquire] must return an image surface
+      (typically created for the occasion, e.g. by decoding a part of
+      a large image) holding the pixels of that rectangle, its pixel
+      (0,0) being the point ([x],[y]) of the pattern, and with its
+      device offset set to ([-x],[-y]) (see
+      {!Cairo.Surface.set_device_offset}).  Other surfaces (including
+      destroyed images and surfaces in error) are handled as if
+      [acquire] raised an exception, see below.  Once Cairo is done
+      with it, [release surface] is called.  This allows very large
+      images to be loaded lazily, only for the parts actually drawn.
+
+      [w] and [h] are the size of the pattern (in pattern space), used
+      to compute extents; [content] (default [COLOR_ALPHA]) describes
+      the returned surfaces.
+
+      The callbacks may be called from any drawing operation (and
+      from other threads if the pattern is used in several) and they
+      run with the OCaml runtime lock held, even if the drawing
+      operation released it.  Exceptions raised by the callbacks
+      cannot propagate through Cairo: they are ignored and, for
+      [acquire], nothing can be drawn (Cairo may then report an
+      error).
+
+      Requires Cairo 1.12.
+      @raise Unavailable if the Cairo version is older. *)
+
   val create_linear : x0:float -> y0:float -> x1:float -> y1:float ->
                       [`Linear | `Gradient] t
   (** Create a new linear gradient {!Cairo.Pattern.t} along the line
@@ -1667,6 +2278,111 @@ sig
      each specified as a center coordinate and a radius.
      @return (x0, y0, r0, x1, y1, r1).      *)
 
+  (** Mesh patterns (also called tensor-product patch meshes).  They
+      require Cairo 1.12; with older versions, the functions of this
+      module raise {!Cairo.Unavailable}.
+
+      A mesh pattern is made of patches, each being a curved
+      quadrilateral (a Coons patch) with a color given at each of its
+      corners and smoothly interpolated inside.  It allows to paint
+      smooth-shaded surfaces (e.g. terrains or heat maps) with a
+      single {!Cairo.paint} and is kept as such in PDF and PostScript
+      output.  A patch is defined by
+      {[
+      Mesh.begin_patch pat;
+      Mesh.move_to pat x0 y0;
+      Mesh.line_to pat x1 y1;  (* or curve_to *)
+      Mesh.line_to pat x2 y2;
+      Mesh.line_to pat x3 y3;
+      Mesh.set_corner_color_rgb pat 0 r0 g0 b0;  (* ... 3 *)
+      Mesh.end_patch pat
+      ]}
+      If fewer than four sides are given, the patch is closed with
+      straight lines (so three sides give a triangle).  Invalid
+      construction sequences raise [Error INVALID_MESH_CONSTRUCTION]. *)
+  module Mesh : sig
+    val create : unit -> [`Mesh] t
+    (** [create()] creates a new mesh pattern, with no patch. *)
+
+    val begin_patch : [> `Mesh] t -> unit
+    (** Begin a patch in a mesh pattern.  After calling this function,
+        the patch shape should be defined with {!move_to},
+        {!line_to} and {!curve_to}, and its corner colors with
+        {!set_corner_color_rgb} or {!set_corner_color_rgba}. *)
+
+    val end_patch : [> `Mesh] t -> unit
+    (** Indicates the end of the current patch in a mesh pattern.
+        Corners whose color was not set are transparent black.  *)
+
+    val move_to : [> `Mesh] t -> float -> float -> unit
+    (** [move_to pat x y] defines the first point of the current
+        patch. *)
+
+    val line_to : [> `Mesh] t -> float -> float -> unit
+    (** [line_to pat x y] adds a line to the current patch from the
+        current point to ([x],[y]).  A patch has at most 4 sides. *)
+
+    val curve_to : [> `Mesh] t -> float -> float -> float -> float ->
+                   float -> float -> unit
+    (** [curve_to pat x1 y1 x2 y2 x3 y3] adds a cubic Bézier spline
+        to the current patch from the current point to ([x3],[y3]),
+        using ([x1],[y1]) and ([x2],[y2]) as the control points. *)
+
+    val set_control_point : [> `Mesh] t -> int -> float -> float -> unit
+    (** [set_control_point pat i x y] sets the internal control point
+        [i] (0 to 3) of the current patch.  By default, they are
+        computed from the sides of the patch. *)
+
+    val set_corner_color_rgb : [> `Mesh] t -> int ->
+                               float -> float -> float -> unit
+    (** [set_corner_color_rgb pat i r g b] sets the color of the corner
+        [i] (0 to 3) of the current patch. *)
+
+    val set_corner_color_rgba : [> `Mesh] t -> int ->
+                                float -> float -> float -> float -> unit
+    (** [set_corner_color_rgba pat i r g b a] sets the color and
+        transparency of the corner [i] (0 to 3) of the current
+        patch. *)
+
+    val get_patch_count : [> `Mesh] t -> int
+    (** [get_patch_count pat] returns the number of patches of [pat]. *)
+
+    val get_control_point : [> `Mesh] t -> int -> int -> float * float
+    (** [get_control_point pat patch i] returns the control point [i]
+        of the patch number [patch].
+        @raise Error [INVALID_INDEX] if the indices are not valid. *)
+
+    val get_corner_color_rgba : [> `Mesh] t -> int -> int ->
+                                float * float * float * float
+    (** [get_corner_color_rgba pat patch i] returns the color
+        [(r, g, b, a)] of the corner [i] of the patch number [patch].
+        @raise Error [INVALID_INDEX] if the indices are not valid. *)
+
+    val add_triangles :
+      [> `Mesh] t ->
+      (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t ->
+      (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t ->
+      unit
+    (** [add_triangles pat points colors] adds to [pat] a triangular
+        patch for each triple of points in [points]
+        ([[| x0; y0; x1; y1; x2; y2; ... |]]), the colors of their
+        corners being given in [colors] as [[| r0; g0; b0; a0; r1;... |]]
+        (so [colors] is twice as long as [points]).  This is
+        equivalent to, but much faster than, defining each patch with
+        the functions above.
+        @raise Invalid_argument if the lengths of the bigarrays are
+        not consistent. *)
+
+    val add_quads :
+      [> `Mesh] t ->
+      (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t ->
+      (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t ->
+      unit
+    (** [add_quads pat points colors] is the same as {!add_triangles}
+        for quadrilaterals with straight sides, each given by 4
+        consecutive points of [points]. *)
+  end
+
   (** This is used to describe how pattern color/alpha will be
       determined for areas "outside" the pattern's natural area (for
       example, outside the surface bounds or outside the gradient
@@ -1753,6 +2469,135 @@ sig
 end
 
 
+(* ---------------------------------------------------------------------- *)
+(** {2:regions  Regions} *)
+
+(** Representing a pixel-aligned area.  Regions are a simple
+    graphical data type representing an area of integer-aligned
+    rectangles.  They are often used on raster surfaces to track areas
+    of interest, such as change or clip areas (e.g. to accumulate the
+    damage of a user interface and repaint only what changed).
+
+    Regions are mutable: the set operations modify their first
+    argument.  They require Cairo 1.10; with older versions, all the
+    functions of this module raise {!Unavailable}. *)
+module Region :
+sig
+  type t
+  (** A region: a set of integer-aligned rectangles. *)
+
+  type rectangle = { x: int;  y: int;  w: int;  h: int }
+  (** A rectangle with integer coordinates: [x] and [y] are the
+      coordinates of the top left corner, [w] and [h] the width and
+      height. *)
+
+  type overlap =
+    | IN  (** The contents are entirely inside the region. *)
+    | OUT (** The contents are entirely outside the region. *)
+    | PART (** The contents are partially inside and partially
+               outside the region. *)
+  (** Used as the return value for {!contains_rectangle}. *)
+
+  val create : unit -> t
+  (** [create()] returns a new empty region. *)
+
+  val create_rectangle : rectangle -> t
+  (** [create_rectangle r] returns a region containing [r]. *)
+
+  val of_rectangles : rectangle array -> t
+  (** [of_rectangles rects] returns the union of the rectangles
+      [rects]. *)
+
+  val copy : t -> t
+  (** [copy r] returns a new region containing the same area as [r]. *)
+
+  val extents : t -> rectangle
+  (** [extents r] returns the bounding rectangle of [r]. *)
+
+  val num_rectangles : t -> int
+  (** [num_rectangles r] returns the number of rectangles contained in
+      [r]. *)
+
+  val get_rectangle : t -> int -> rectangle
+  (** [get_rectangle r i] returns the [i]th rectangle of [r].
+      @raise Invalid_argument if [i] is not in the range
+      [0 .. num_rectangles r - 1]. *)
+
+  val iter : (rectangle -> unit) -> t -> unit
+  (** [iter f r] applies [f] to all the rectangles of [r] (which
+      are disjoint). *)
+
+  val fold : ('a -> rectangle -> 'a) -> t -> 'a -> 'a
+  (** [fold f r a] computes [f (... (f (f a r0) r1) ...) rN] where
+      [r0],..., [rN] are the rectangles of [r]. *)
+
+  val to_array : t -> rectangle array
+  (** [to_array r] returns the rectangles of [r]. *)
+
+  val is_empty : t -> bool
+  (** [is_empty r] checks whether [r] is empty. *)
+
+  val contains_point : t -> int -> int -> bool
+  (** [contains_point r x y] checks whether the point ([x],[y]) is
+      contained in [r]. *)
+
+  val contains_rectangle : t -> rectangle -> overlap
+  (** [contains_rectangle r rect] checks whether [rect] is inside,
+      outside or partially contained in [r]. *)
+
+  val equal : t -> t -> bool
+  (** [equal a b] checks whether [a] and [b] contain the same area. *)
+
+  val translate : t -> int -> int -> unit
+  (** [translate r dx dy] translates [r] by ([dx],[dy]). *)
+
+  val union : t -> t -> unit
+  (** [union dst other] computes the union of [dst] with [other] and
+      places the result in [dst]. *)
+
+  val union_rectangle : t -> rectangle -> unit
+  (** [union_rectangle dst rect] computes the union of [dst] with
+      [rect] and places the result in [dst]. *)
+
+  val intersect : t -> t -> unit
+  (** [intersect dst other] computes the intersection of [dst] with
+      [other] and places the result in [dst]. *)
+
+  val intersect_rectangle : t -> rectangle -> unit
+  (** [intersect_rectangle dst rect] computes the intersection of
+      [dst] with [rect] and places the result in [dst]. *)
+
+  val subtract : t -> t -> unit
+  (** [subtract dst other] subtracts [other] from [dst] and places the
+      result in [dst]. *)
+
+  val subtract_rectangle : t -> rectangle -> unit
+  (** [subtract_rectangle dst rect] subtracts [rect] from [dst] and
+      places the result in [dst]. *)
+
+  val xor : t -> t -> unit
+  (** [xor dst other] computes the exclusive difference of [dst] with
+      [other] and places the result in [dst].  That is, [dst] will be
+      set to contain all areas that are either in [dst] or in [other],
+      but not in both. *)
+
+  val xor_rectangle : t -> rectangle -> unit
+  (** [xor_rectangle dst rect] computes the exclusive difference of
+      [dst] with [rect] and places the result in [dst]. *)
+
+  val clip : context -> t -> unit
+  (** [clip cr r] intersects the current clip region of [cr] with
+      [r], the coordinates of [r] being taken in user space.  Like
+      {!Cairo.clip}, it replaces the current path of [cr] (by an empty
+      one). *)
+
+  val mark_dirty : Surface.t -> t -> unit
+  (** [mark_dirty surface r] is like
+      {!Cairo.Surface.mark_dirty_rectangle} for all the rectangles of
+      [r]. *)
+end
+
+
 (* ---------------------------------------------------------------------- *)
 (** {2:cairo_t The cairo drawing context functions} *)
 
@@ -1767,6 +2612,16 @@ val create : Surface.t -> context
 
    @raise Out_of_memory if the context could not be allocated. *)
 
+val destroy : context -> unit
+(** [destroy cr] releases [cr] (and its reference to the target
+   surface) immediately instead of waiting for the GC to do it.  Any
+   subsequent use of [cr] raises [Error NULL_POINTER] ([Out_of_memory]
+   with Cairo < 1.12).  Destroying [cr] several times is harmless. *)
+
+val with_context : Surface.t -> (context -> 'a) -> 'a
+(** [with_context target f] creates a context [cr] for [target] and
+   returns [f cr], destroying [cr] when [f] returns or raises. *)
+
 val save : context -> unit
 (** [save cr] makes a copy of the current state of [cr] and saves it
    on an internal stack of saved states for [cr].  When [restore] is
@@ -2191,6 +3046,22 @@ val clip_rectangle_list : context -> rectangle list
    Raises [Error(CLIP_NOT_REPRESENTABLE)] to indicate that the clip
    region cannot be represented as a list of user-space rectangles. *)
 
+type insideness =
+  (int, Bigarray.int8_unsigned_elt, Bigarray.c_layout) Bigarray.Array1.t
+(** Results of {!Cairo.in_fill_many}, {!Cairo.in_stroke_many} and
+   {!Cairo.in_clip_many}: one byte per point, [1] if the point is
+   inside and [0] otherwise. *)
+
+val in_clip_many : context -> ?dst: insideness -> Matrix.points -> insideness
+(** [in_clip_many cr points] tests, for each point ([x],[y]) of
+   [points] (in user space), whether it is inside the area that would
+   be visible through the current clip, i.e. whether a {!Cairo.paint}
+   would affect it.  The result has one entry per point, [1] if the
+   point is inside and [0] otherwise.  It is [dst] if given, a fresh
+   bigarray otherwise.  See {!Cairo.in_fill_many}.
+
+   @raise Unavailable if Cairo is older than 1.10. *)
+
 
 val fill : context -> unit
 (** A drawing operator that fills the current path according to the
@@ -2233,6 +3104,17 @@ val in_fill : context -> float -> float -> bool
 
    See also {!Cairo.fill} and {!Cairo.set_fill_rule}.  *)
 
+val in_fill_many : context -> ?dst: insideness -> Matrix.points -> insideness
+(** [in_fill_many cr points] performs {!Cairo.in_fill} for each point
+   ([x],[y]) of [points], in a single call.  The result has one entry
+   per point (the [i]th point being ([points.{2*i}],
+   [points.{2*i+1}])), set to [1] if the point is inside and to [0]
+   otherwise.  The result is written to [dst] if given (which allows
+   to reuse it), and to a fresh bigarray otherwise.
+
+   @raise Invalid_argument if [points] has an odd length or [dst]
+   does not have half the length of [points]. *)
+
 val mask : context -> 'a Pattern.t -> unit
 (** [mask cr pattern]: a drawing operator that paints the current
    source using the alpha channel of [pattern] as a mask.  (Opaque
@@ -2314,6 +3196,10 @@ val in_stroke : context -> float -> float -> bool
    stroking parameters. Surface dimensions and clipping are not taken
    into account.  *)
 
+val in_stroke_many : context -> ?dst: insideness -> Matrix.points -> insideness
+(** [in_stroke_many cr points] performs {!Cairo.in_stroke} for each
+   point of [points].  See {!Cairo.in_fill_many}. *)
+
 val copy_page : context -> unit
 (** [copy_page cr] emits the current page for backends that support
    multiple pages, but doesn't clear it, so, the contents of the
@@ -2364,6 +3250,16 @@ sig
      type [CURVE_TO] which will instead be replaced by a series of
      [LINE_TO] elements.  *)
 
+  val destroy : t -> unit
+  (** [destroy path] releases the memory held by [path] immediately
+     instead of waiting for the GC to do it (the data of bigarrays
+     obtained with {!to_bigarray} stays valid).  Afterwards, [path]
+     is empty and appending it raises [Error NULL_POINTER]. *)
+
+  val with_path : t -> (t -> 'a) -> 'a
+  (** [with_path path f] returns [f path] and destroys [path] when [f]
+     returns or raises. *)
+
   val append : context -> t -> unit
   (** Append the path onto the current path.  The path may be either
      the return value from one of {!Cairo.Path.copy} or
@@ -2487,10 +3383,85 @@ sig
   val to_array : t -> path_data array
 
   val of_array : path_data array -> t
+
+  val lines_of_bigarray : context -> ?closed:bool ->
+    (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t -> unit
+  (** [lines_of_bigarray cr points] adds the polyline whose vertices
+     are [points] = [x0, y0, x1, y1,...] to the current path: it is
+     equivalent to {!Cairo.move_to}[ cr x0 y0] followed by
+     {!Cairo.line_to}[ cr xi yi] for the remaining points, but the
+     loop runs in C and the status of [cr] is only checked once at the
+     end.  If [closed] is [true] (default: [false]), the sub-path is
+     closed with {!Cairo.Path.close}, giving a polygon.  An empty
+     bigarray does nothing.
+
+     @raise Invalid_argument if the length of [points] is odd. *)
+
+  val curves_of_bigarray : context -> ?closed:bool ->
+    (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t -> unit
+  (** [curves_of_bigarray cr points] is like
+     {!Cairo.Path.lines_of_bigarray} for a sequence of cubic Bézier
+     splines.  [points] = [x0, y0, x1, y1, x2, y2, x3, y3,...] where
+     [(x0, y0)] is the starting point and each following group of 6
+     floats gives the arguments of a {!Cairo.curve_to}.
+
+     @raise Invalid_argument if the length of [points] is not of the
+     form 2 + 6k. *)
+
+  (** {3 Packed representation}
+
+     The following functions give access to the path data as stored
+     by Cairo, without converting each element to a {!path_data}
+     value.  The data is a [num_data × 2] bigarray: each path element
+     is a header row, giving its type and its length (the number of
+     rows it occupies, including the header), followed by its points
+     [(x, y)], one per row.  For example, the points of a [CURVE_TO]
+     element whose header is at row [i] are
+     [(data.{i+1,0}, data.{i+1,1})], [(data.{i+2,0}, data.{i+2,1})]
+     and [(data.{i+3,0}, data.{i+3,1})]. *)
+
+  type data = (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array2.t
+
+  type element_type =
+    | PATH_MOVE_TO     (** Header followed by 1 point. *)
+    | PATH_LINE_TO     (** Header followed by 1 point. *)
+    | PATH_CURVE_TO    (** Header followed by 3 points. *)
+    | PATH_CLOSE_PATH  (** Header only. *)
+
+  val to_bigarray : t -> data
+  (** [to_bigarray p] returns a view of the data of [p] (no copy is
+     made).  The data remains valid as long as [p] or any of the views
+     is alive.  Although nothing prevents it, the view must be
+     considered as read-only: rows holding a header must not be
+     modified with bigarray assignments.  *)
+
+  val of_bigarray : data -> t
+  (** [of_bigarray data] creates a path from a copy of [data].
+
+     @raise Error INVALID_PATH_DATA if [data] is not a valid sequence
+     of path elements.
+     @raise Invalid_argument if [Bigarray.Array2.dim2 data <> 2]. *)
+
+  val get_type : data -> int -> element_type
+  (** [get_type data i] returns the type of the element whose header
+     is at row [i].
+     @raise Invalid_argument if row [i] does not exist or is not a
+     header. *)
+
+  val get_length : data -> int -> int
+  (** [get_length data i] returns the number of rows occupied by the
+     element whose header is at row [i].  Thus the next element header
+     is at row [i + get_length data i]. *)
+
+  val set_header : data -> int -> element_type -> unit
+  (** [set_header data i ty] makes row [i] a header for an element of
+     type [ty] (its length being set accordingly).  This is used to
+     build path data to be passed to {!of_bigarray}. *)
 end
 
-val arc : context ->
-          float -> float -> r:float -> a1:float -> a2:float -> unit
+external arc : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+  r:(float [@unboxed]) -> a1:(float [@unboxed]) -> a2:(float [@unboxed]) ->
+  unit = "caml_cairo_arc_bc" "caml_cairo_arc_unboxed" [@@noalloc]
 (** [arc xc yc radius angle1 angle2] adds a circular arc of the given
    radius to the current path.  The arc is centered at [(xc, yc)],
    begins at [angle1] and proceeds in the direction of increasing
@@ -2531,8 +3502,10 @@ val arc : context ->
    restore cr;
    ]} *)
 
-val arc_negative : context ->
-                   float -> float -> r:float -> a1:float -> a2:float -> unit
+external arc_negative : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+  r:(float [@unboxed]) -> a1:(float [@unboxed]) -> a2:(float [@unboxed]) ->
+  unit = "caml_cairo_arc_negative_bc" "caml_cairo_arc_negative_unboxed"
+  [@@noalloc]
 (** [arc_negative xc yc radius angle1 angle2] adds a circular arc of
    the given radius to the current path.  The arc is centered at [(xc,
    yc)], begins at [angle1] and proceeds in the direction of
@@ -2543,8 +3516,10 @@ val arc_negative : context ->
    See {!Cairo.arc} for more details.  This function differs only in
    the direction of the arc between the two angles. *)
 
-val curve_to : context ->
-               float -> float -> float -> float -> float -> float -> unit
+external curve_to : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+                    (float [@unboxed]) -> (float [@unboxed]) ->
+                    (float [@unboxed]) -> (float [@unboxed]) -> unit
+  = "caml_cairo_curve_to_bc" "caml_cairo_curve_to_unboxed" [@@noalloc]
 (** [curve_to ctx x1 y1 x2 y2 x3 y3] Adds a cubic Bézier spline to the
    path from the current point to position (x3, y3) in user-space
    coordinates, using (x1, y1) and (x2, y2) as the control points.
@@ -2554,7 +3529,8 @@ val curve_to : context ->
    function will behave as if preceded by a call to
    {!Cairo.move_to}[ cr x1 y1]. *)
 
-val line_to : context -> float -> float -> unit
+external line_to : context -> (float [@unboxed]) -> (float [@unboxed]) -> unit
+  = "caml_cairo_line_to" "caml_cairo_line_to_unboxed" [@@noalloc]
 (** Adds a line to the path from the current point to position (x, y)
    in user-space coordinates. After this call the current point will
    be (x, y).
@@ -2562,11 +3538,21 @@ val line_to : context -> float -> float -> unit
    If there is no current point before the call to [Cairo.line_to],
    this function will behave as {!Cairo.move_to}[ cr x y]. *)
 
-val move_to : context -> float -> float -> unit
-(** Begin a new sub-path.  After this call the current point will be (x, y). *)
-
-val rectangle : context ->
-                float -> float -> w:float -> h:float -> unit
+external move_to : context -> (float [@unboxed]) -> (float [@unboxed]) -> unit
+  = "caml_cairo_move_to" "caml_cairo_move_to_unboxed" [@@noalloc]
+(** Begin a new sub-path.  After this call the current point will be (x, y).
+
+   For speed, the path construction functions {!Cairo.move_to},
+   {!Cairo.line_to}, {!Cairo.curve_to}, {!Cairo.rectangle},
+   {!Cairo.arc}, {!Cairo.arc_negative} and their [rel_*] variants do
+   not check the status of the context.  Since errors
+   are sticky in Cairo, a failure is reported by the next function
+   that checks it, for example {!Cairo.fill}, {!Cairo.stroke} or
+   {!Cairo.Path.get_current_point}. *)
+
+external rectangle : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+  w:(float [@unboxed]) -> h:(float [@unboxed]) -> unit
+  = "caml_cairo_rectangle" "caml_cairo_rectangle_unboxed" [@@noalloc]
 (** [rectangle x y w h] adds a closed sub-path rectangle of the given
    size to the current path at position (x, y) in user-space
    coordinates.
@@ -2580,8 +3566,10 @@ val rectangle : context ->
    Path.close cr;
    ]}  *)
 
-val rel_curve_to : context ->
-                   float -> float -> float -> float -> float -> float -> unit
+external rel_curve_to : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+                        (float [@unboxed]) -> (float [@unboxed]) ->
+                        (float [@unboxed]) -> (float [@unboxed]) -> unit
+  = "caml_cairo_rel_curve_to_bc" "caml_cairo_rel_curve_to_unboxed" [@@noalloc]
 (** [rel_curve_to x1 y1 x2 y2 x3 y3] relative-coordinate version of
    {!Cairo.curve_to}.  All offsets are relative to the current point.
    Adds a cubic Bézier spline to the path from the current point to a
@@ -2594,9 +3582,11 @@ val rel_curve_to : context ->
    (x+.dx2) (y+.dy2) (x+.dx3) (y+.dy3)].
 
    It is an error to call this function with no current point.  Doing
-   so will cause [Error NO_CURRENT_POINT] to be raised.  *)
+   so will cause [Error NO_CURRENT_POINT] to be raised (see
+   {!Cairo.move_to} for when).  *)
 
-val rel_line_to : context -> float -> float -> unit
+external rel_line_to : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+  unit = "caml_cairo_rel_line_to" "caml_cairo_rel_line_to_unboxed" [@@noalloc]
 (** Relative-coordinate version of {!Cairo.line_to}.  Adds a line to
    the path from the current point to a point that is offset from the
    current point by (dx, dy) in user space. After this call the
@@ -2606,9 +3596,11 @@ val rel_line_to : context -> float -> float -> unit
    logically equivalent to [line_to cr (x +. dx) (y +. dy)].
 
    It is an error to call this function with no current point.  Doing
-   so will cause [Error NO_CURRENT_POINT] to be raised.  *)
+   so will cause [Error NO_CURRENT_POINT] to be raised (see
+   {!Cairo.move_to} for when).  *)
 
-val rel_move_to : context -> float -> float -> unit
+external rel_move_to : context -> (float [@unboxed]) -> (float [@unboxed]) ->
+  unit = "caml_cairo_rel_move_to" "caml_cairo_rel_move_to_unboxed" [@@noalloc]
 (** Begin a new sub-path. After this call the current point will
    offset by (x, y).
 
@@ -2616,7 +3608,8 @@ val rel_move_to : context -> float -> float -> unit
    logically equivalent to [move_to cr (x +. dx) (y +. dy)].
 
    It is an error to call this function with no current point.  Doing
-   so will cause [Error NO_CURRENT_POINT] to be raised. *)
+   so will cause [Error NO_CURRENT_POINT] to be raised (see
+   {!Cairo.move_to} for when). *)
 
 
 
@@ -2692,3 +3685,157 @@ val device_to_user_distance : context -> float -> float -> float * float
    from device space to user space.  This function is similar to
    {!Cairo.device_to_user} except that the translation components of
    the inverse CTM will be ignored when transforming ([dx],[dy]). *)
+
+val user_to_device_points : context -> ?dst: Matrix.points -> Matrix.points
+                            -> unit
+(** [user_to_device_points cr points] transforms all the [points] from
+   user space to device space, in place or, if given, into [dst].
+   This gives the same results as {!Cairo.user_to_device} on each
+   point but the matrix is only fetched once, which makes it suitable
+   for large sets of points.  The CTM is read when the function is
+   called; changing it afterwards does not affect the result.
+   @raise Invalid_argument if [points] has an odd length or [dst]
+   has not the same length as [points]. *)
+
+val user_to_device_distances : context -> ?dst: Matrix.points ->
+                               Matrix.points -> unit
+(** [user_to_device_distances cr v] is like
+   {!Cairo.user_to_device_points} for distance vectors (see
+   {!Cairo.user_to_device_distance}). *)
+
+val device_to_user_points : context -> ?dst: Matrix.points -> Matrix.points
+                            -> unit
+(** [device_to_user_points cr points] transforms all the [points]
+   from device space to user space.  See
+   {!Cairo.user_to_device_points}. *)
+
+val device_to_user_distances : context -> ?dst: Matrix.points ->
+                               Matrix.points -> unit
+(** [device_to_user_distances cr v] is like
+   {!Cairo.device_to_user_points} for distance vectors (see
+   {!Cairo.device_to_user_distance}). *)
+
+
+(* ---------------------------------------------------------------------- *)
+(** {2:tiled  Rendering large images by tiles} *)
+
+(** Render an image surface by splitting it into tiles that can be
+    drawn concurrently.  Each tile gets its own context drawing
+    directly into the pixels of the target, with a device offset (so
+    the user coordinates are the ones of the target) and a clip
+    restricting it to the tile.
+
+    This library does not decide how the tiles are scheduled: pass a
+    [run] function executing the tasks in parallel.  For example,
+    with OCaml 5 domains:
+    {[
+      let run tasks =
+        List.iter Domain.join (List.map Domain.spawn tasks)
+      let () = Cairo.Tiled.render ~run image draw
+    ]}
+    (in practice, use a pool with as many domains as cores).  With
+    system threads, the tiles are also rendered in parallel since the
+    drawing operations release the runtime lock. *)
+module Tiled :
+sig
+  val render : ?tile:int -> ?run:((unit -> unit) list -> unit) ->
+               Surface.t -> (context -> unit) -> unit
+  (** [render target draw] executes [draw cr] for each tile of the
+      image surface [target], [cr] being a context for that tile.
+      [draw] may be executed concurrently on several tiles, so must
+      not mutate shared state without synchronization.  The target
+      must not be used while [render] runs.  The target of [cr] shares
+      the pixels of [target] and keeps its stride, so
+      {!Image.get_data32} refuses it for the tiles of the bottom row
+      (except the first one).
+
+      @param tile the height of the tiles and (rounded up to a
+      multiple of 32) their width.  Default: [256].
+      @param run executes the list of tasks it is given and returns
+      when all are done, raising an exception if one of them raised.
+      Default: execute them sequentially.
+      @raise Invalid_argument if [target] is not an image surface. *)
+
+  val replay : ?tile:int -> ?run:((unit -> unit) list -> unit) ->
+               Surface.t -> Surface.t -> unit
+  (** [replay target src] paints the surface [src] (typically a
+      recording surface, see {!Recording.create}) onto [target] tile
+      by tile.  See {!render} for the meaning of the optional
+      arguments. *)
+end
+
+
+(* ---------------------------------------------------------------------- *)
+(** {2:raster_cache  Caching the rasterization of recording surfaces} *)
+
+(** Replaying a recording surface (see {!Recording}) renders all its
+    operations again.  When the same recording is drawn frame after
+    frame at the same scale (e.g. the static layers of a map being
+    panned), it is much faster to keep the result of the rendering
+    and to copy it.  A [Raster_cache.t] does that: the rasters are
+    keyed by the recording, the scale of the CTM, the fractional part
+    of its translation (rounded to a fraction of pixel), the clip
+    rectangle and the visible part of the target, and the least
+    recently used ones are dropped when the memory budget is
+    exceeded.
+
+    The rasters are created with {!Surface.create_similar} so should
+    only be used for raster targets.  A recording must not be modified
+    while its rasters are in the cache (use {!Raster_cache.invalidate}
+    after changing it). *)
+module Raster_cache :
+sig
+  type t
+  (** A cache of rasterized recording surfaces. *)
+
+  val create : ?budget:int -> ?subpixel:int -> unit -> t
+  (** [create ()] returns a new empty cache.
+
+      @param budget the maximum number of bytes of pixel data kept by
+      the cache (when the raster would be larger than that, the
+      recording is replayed directly).  Default: 64MB.
+      @param subpixel the fractional part of the translation is
+      rounded to [1 / subpixel] pixel.  A larger value gives a more
+      precise positioning at the price of more rasters when the
+      translation varies.  Default: [4]. *)
+
+  val replay : t -> Surface.t -> ?clip:rectangle -> context -> unit
+  (** [replay cache recording cr] paints [recording] on [cr], as
+      {!Recording.replay}[ recording ?clip cr] would, using a cached
+      raster if possible.  The raster is drawn pixel-aligned, so the
+      result is the same as replaying the recording with the
+      translation of the CTM rounded as said above.  A raster only
+      covers the part of the recording inside the clip of [cr]
+      (enlarged to a grid of 256 device pixels so that it can be
+      reused while panning), so a cache is best used with targets of
+      a constant size.  If the CTM contains a rotation, a shear or a
+      reflection, or if the raster would be over the budget or larger
+      than 32767 pixels in either direction, the recording is replayed
+      directly and the cache is not used. *)
+
+  val invalidate : t -> Surface.t -> unit
+  (** [invalidate cache recording] drops all rasters of [recording].
+      This also works after [recording] has been destroyed (see
+      {!Surface.destroy}). *)
+
+  val clear : t -> unit
+  (** [clear cache] drops all the rasters. *)
+
+  val length : t -> int
+  (** [length cache] returns the number of rasters in [cache]. *)
+
+  val size : t -> int
+  (** [size cache] returns the number of bytes of pixel data held by
+      [cache]. *)
+
+  val hits : t -> int
+  (** [hits cache] returns the number of times a raster was reused. *)
+
+  val misses : t -> int
+  (** [misses cache] returns the number of times a raster had to be
+      rendered. *)
+
+  val evictions : t -> int
+  (** [evictions cache] returns the number of rasters dropped to stay
+      within the budget. *)
+end
@@ -101,6 +101,108 @@
                        argv[5], argv[6]);                               \
   }
 
+/* Path construction functions that do not check the status of the
+   context: errors are sticky in the context, so a failure is reported
+   by the next function checking the status of [cr] (e.g. fill or
+   stroke).  They neither allocate nor raise.  The native code version
+   takes unboxed floats; the bytecode one (boxed floats, with a [_bc]
+   variant when there are more than 5 arguments) calls it, so that
+   errors are reported at the same place by both backends. */
+
+#define DO2_CONTEXT_UNBOXED(name)                                      \
+  CAMLexport value caml_##name##_unboxed(value vcr, double v1, double v2) \
+  {                                                                     \
+    /* noalloc */                                                       \
+    name(CAIRO_VAL(vcr), v1, v2);                                       \
+    return(Val_unit);                                                   \
+  }                                                                     \
+                                                                        \
+  CAMLexport value caml_##name(value vcr, value v1, value v2)           \
+  {                                                                     \
+    return caml_##name##_unboxed(vcr, Double_val(v1), Double_val(v2));  \
+  }
+
+#define DO4_CONTEXT_UNBOXED(name)                                      \
+  CAMLexport value caml_##name##_unboxed(value vcr, double v1, double v2, \
+                                         double v3, double v4)          \
+  {                                                                     \
+    /* noalloc */                                                       \
+    name(CAIRO_VAL(vcr), v1, v2, v3, v4);                               \
+    return(Val_unit);                                                   \
+  }                                                                     \
+                                                                        \
+  CAMLexport value caml_##name(value vcr, value v1, value v2, value v3, \
+                               value v4)                                \
+  {                                                                     \
+    return caml_##name##_unboxed(vcr, Double_val(v1), Double_val(v2),   \
+                                 Double_val(v3), Double_val(v4));       \
+  }
+
+#define DO5_CONTEXT_UNBOXED(name)                                      \
+  CAMLexport value caml_##name##_unboxed(value vcr, double v1, double v2, \
+                                         double v3, double v4, double v5) \
+  {                                                                     \
+    /* noalloc */                                                       \
+    name(CAIRO_VAL(vcr), v1, v2, v3, v4, v5);                           \
+    return(Val_unit);                                                   \
+  }                                                                     \
+                                                                        \
+  CAMLexport value caml_##name##_bc(value * argv, int argn)             \
+  {                                                                     \
+    return caml_##name##_unboxed(argv[0], Double_val(argv[1]),          \
+                                 Double_val(argv[2]), Double_val(argv[3]), \
+                                 Double_val(argv[4]), Double_val(argv[5])); \
+  }
+
+#define DO6_CONTEXT_UNBOXED(name)                                      \
+  CAMLexport value caml_##name##_unboxed(value vcr, double v1, double v2, \
+                                         double v3, double v4, double v5, \
+                                         double v6)                     \
+  {                                                                     \
+    /* noalloc */                                                       \
+    name(CAIRO_VAL(vcr), v1, v2, v3, v4, v5, v6);                       \
+    return(Val_unit);                                                   \
+  }                                                                     \
+                                                                        \
+  CAMLexport value caml_##name##_bc(value * argv, int argn)             \
+  {                                                                     \
+    return caml_##name##_unboxed(argv[0], Double_val(argv[1]),          \
+                                 Double_val(argv[2]), Double_val(argv[3]), \
+                                 Double_val(argv[4]), Double_val(argv[5]), \
+                                 Double_val(argv[6]));                  \
+  }
+
+
+/* Execute [action] without holding the OCaml runtime lock, so other
+   threads (and domains) can run.  [action] must not access the OCaml
+   heap: all the values it needs must be extracted before and the
+   OCaml values holding them registered as roots so they are not
+   finalized in the meantime.  Callbacks triggered by [action] take
+   the lock back if they run OCaml code (see
+   CALLBACK_LEAVE_BLOCKING). */
+#define RELEASE_RUNTIME_LOCK(action)                                    \
+  caml_enter_blocking_section();                                        \
+  caml_cairo_lock_released = 1;                                         \
+  action;                                                               \
+  caml_cairo_lock_released = 0;                                         \
+  caml_leave_blocking_section()
+
+/* Same as RELEASE_RUNTIME_LOCK if [surf] allows it. */
+#define WITHOUT_RUNTIME_LOCK(surf, action)                              \
+  if (caml_cairo_surface_may_release(surf)) {                           \
+    RELEASE_RUNTIME_LOCK(action);                                       \
+  }                                                                     \
+  else { action; }
+
+#define DO_CONTEXT_BLOCKING(name)                                      \
+  CAMLexport value caml_##name(value vcr)                               \
+  {                                                                     \
+    CAMLparam1(vcr);                                                    \
+    cairo_t *cr = CAIRO_VAL(vcr);                                       \
+    WITHOUT_RUNTIME_LOCK(cairo_get_target(cr), name(cr));               \
+    caml_check_status(cr);                                              \
+    CAMLreturn(Val_unit);                                               \
+  }
 
 /* The return value should not require special alloc. */
 #define GET_CONTEXT(name, value_of, ty)                        \
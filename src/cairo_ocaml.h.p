@@ -69,6 +69,12 @@ extern struct custom_operations caml_scaled_font_ops;
 #define SURFACE_VAL(v) (* (cairo_surface_t **) Data_custom_val(v))
 extern struct custom_operations caml_surface_ops;
 
+/* cairo_region_t (Cairo >= 1.10)
+***********************************************************************/
+
+#define REGION_VAL(v) (* (cairo_region_t **) Data_custom_val(v))
+extern struct custom_operations caml_region_ops;
+
 /* Type cairo_content_t */
 
 #define SET_CONTENT_VAL(c, vcontent)                                    \
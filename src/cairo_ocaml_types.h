@@ -35,6 +35,33 @@ static intnat caml_cairo_hash_pointer(value v)
 
 #define ALLOC(name) caml_alloc_custom(&caml_##name##_ops, sizeof(void*), 1, 50)
 
+/* Allocate a custom block of [size] bytes for a value owning [mem]
+   bytes outside the OCaml heap (e.g. the pixels of an image), so that
+   the GC speeds up accordingly instead of seeing a mere pointer. */
+#if OCAML_VERSION >= 40800
+#define ALLOC_MEM(name, size, mem)                              \
+  caml_alloc_custom_mem(&caml_##name##_ops, size, mem)
+#else
+#define CAML_CAIRO_MAX_MEM (256 * 1024 * 1024)
+#define ALLOC_MEM(name, size, mem)                                      \
+  caml_alloc_custom(&caml_##name##_ops, size, mem, CAML_CAIRO_MAX_MEM)
+#endif
+
+/* Reference counting of bigarray proxies.  They may be shared with
+   bigarrays finalized by the GC of other domains, so the counts are
+   updated atomically (the [refcount] field is atomic in OCaml 5). */
+#if OCAML_VERSION >= 50000
+#define PROXY_INCR(p) (++ (p)->refcount)
+#define PROXY_DECR(p) (-- (p)->refcount)
+#elif defined(__GNUC__)
+#define PROXY_INCR(p) __sync_add_and_fetch(&(p)->refcount, 1)
+#define PROXY_DECR(p) __sync_sub_and_fetch(&(p)->refcount, 1)
+#else
+/* Only updated with the runtime lock held. */
+#define PROXY_INCR(p) (++ (p)->refcount)
+#define PROXY_DECR(p) (-- (p)->refcount)
+#endif
+
 /* Type cairo_t
 ***********************************************************************/
 
@@ -84,13 +111,80 @@ CAMLexport value caml_cairo_status_to_string(value vstatus)
 
 DEFINE_CUSTOM_OPERATIONS(pattern, cairo_pattern_destroy, PATTERN_VAL)
 
+/* Sources, masks and paths in error (which includes destroyed ones)
+   would put the context they are used with in error.  These accessors
+   raise [Error] beforehand, leaving the context untouched. */
+static cairo_pattern_t * caml_cairo_pattern_ok(value vpat)
+{
+  cairo_pattern_t *pat = PATTERN_VAL(vpat);
+  caml_cairo_raise_Error(cairo_pattern_status(pat));
+  return(pat);
+}
+
 /* Type cairo_surface_t
 ***********************************************************************/
 
 #define SURFACE_ASSIGN(v, x) v = ALLOC(surface); SURFACE_VAL(v) = x
 
+/* For newly created surfaces (not for additional references to
+   existing ones, their memory is already accounted for). */
+#define SURFACE_ASSIGN_MEM(v, x, mem)                                   \
+  v = ALLOC_MEM(surface, sizeof(void*), mem);  SURFACE_VAL(v) = x
+
+/* Memory used by the pixels of an image surface, 0 for other surfaces. */
+#define IMAGE_SURFACE_MEM(x)                                            \
+  ((mlsize_t) cairo_image_surface_get_stride(x)                         \
+   * cairo_image_surface_get_height(x))
+
 DEFINE_CUSTOM_OPERATIONS(surface, cairo_surface_destroy, SURFACE_VAL)
 
+/* Destroyed surfaces are replaced by a (shared) finished surface. */
+static cairo_surface_t *caml_cairo_surface_destroyed = NULL;
+
+static cairo_surface_t *caml_cairo_get_surface_destroyed(void)
+{
+  if (caml_cairo_surface_destroyed == NULL) {
+    caml_cairo_surface_destroyed =
+      cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 0, 0);
+    cairo_surface_finish(caml_cairo_surface_destroyed);
+  }
+  return(caml_cairo_surface_destroyed);
+}
+
+static cairo_surface_t * caml_cairo_surface_ok(value vsurf)
+{
+  cairo_surface_t *surf = SURFACE_VAL(vsurf);
+  if (surf == caml_cairo_surface_destroyed)
+    caml_cairo_raise_Error(CAIRO_STATUS_SURFACE_FINISHED);
+  caml_cairo_raise_Error(cairo_surface_status(surf));
+  return(surf);
+}
+
+/* Whether the current thread released the runtime lock (see
+   WITHOUT_RUNTIME_LOCK).  Callbacks that Cairo may invoke in the
+   middle of a drawing operation (e.g. the acquire function of raster
+   sources) use it to take the lock back before running OCaml code. */
+#if defined(_MSC_VER)
+static __declspec(thread) int caml_cairo_lock_released = 0;
+#else
+static __thread int caml_cairo_lock_released = 0;
+#endif
+
+/* Run OCaml code from a Cairo callback: [LEAVE] must be balanced by
+   [ENTER] in the same function. */
+#define CALLBACK_LEAVE_BLOCKING(released)                               \
+  int released = caml_cairo_lock_released;                              \
+  if (released) {                                                       \
+    caml_cairo_lock_released = 0;                                       \
+    caml_leave_blocking_section();                                      \
+  }
+
+#define CALLBACK_ENTER_BLOCKING(released)                               \
+  if (released) {                                                       \
+    caml_enter_blocking_section();                                      \
+    caml_cairo_lock_released = 1;                                       \
+  }
+
 /* Some surfaces have a callback attached.  We must store its value at
    a location that exists for the lifetime of the surface so one can
    pass a pointer to it to the *_for_stream functions and the
@@ -99,10 +193,14 @@ DEFINE_CUSTOM_OPERATIONS(surface, cairo_surface_destroy, SURFACE_VAL)
    store it in the surface (thanks Cairo!). */
 static const cairo_user_data_key_t surface_callback;
 
+/* The surface may be destroyed while the runtime lock is released
+   (e.g. when the last context using it is). */
 static void caml_destroy_surface_callback(void *data)
 {
   /* fprintf(stderr, "DESTROY surface callback\n");  fflush(stderr); */
+  CALLBACK_LEAVE_BLOCKING(released);
   caml_remove_generational_global_root((value *)data);
+  CALLBACK_ENTER_BLOCKING(released);
   free(data);
 }
 
@@ -114,8 +212,137 @@ static void caml_destroy_surface_callback(void *data)
     cairo_surface_set_user_data (surf, &surface_callback, output,       \
                                  &caml_destroy_surface_callback))
 
+/* Whether the OCaml runtime lock may be released while [surf] is
+   drawn on or finished: not if it calls back OCaml to write its
+   output. */
+static int caml_cairo_surface_may_release(cairo_surface_t *surf)
+{
+  return(cairo_surface_get_user_data(surf, &surface_callback) == NULL);
+}
+
+
+
+/* Image.Pool.t: idle pixel buffers of image surfaces, to be reused.
+   A buffer is lent with a bigarray proxy extended with the pool
+   (marked by [size] which is only used by memory mapped files
+   otherwise).  When the proxy is finalized by Cairo (see
+   caml_cairo_image_bigarray_finalize), possibly without the runtime
+   lock, the buffer goes back to the pool.  The pool itself is freed
+   when both its OCaml value is finalized and no buffer is lent.
+   Buffers viewed by bigarrays are detached from the pool (see
+   caml_cairo_pool_proxy_detach). */
+#define CAML_CAIRO_POOLED_PROXY ((uintnat) -1)
+
+struct caml_cairo_image_pool;
+
+struct caml_cairo_pool_proxy {
+  struct caml_ba_proxy proxy; /* must be first */
+  struct caml_cairo_image_pool *pool;
+  size_t bytes;
+  struct caml_cairo_pool_proxy *next; /* in the list of idle buffers */
+};
+
+struct caml_cairo_image_pool {
+  volatile long lock;
+  int closed;          /* the OCaml value was finalized */
+  intnat lent;         /* number of buffers used by surfaces */
+  size_t max_bytes;    /* maximum size of the idle buffers */
+  size_t idle_bytes;
+  intnat hits, misses;
+  struct caml_cairo_pool_proxy *idle;
+};
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define POOL_LOCK(p) while (_InterlockedExchange(&(p)->lock, 1)) {}
+#define POOL_UNLOCK(p) _InterlockedExchange(&(p)->lock, 0)
+#else
+#define POOL_LOCK(p) while (__sync_lock_test_and_set(&(p)->lock, 1)) {}
+#define POOL_UNLOCK(p) __sync_lock_release(&(p)->lock)
+#endif
+
+#define IMAGE_POOL_VAL(v) \
+  (* (struct caml_cairo_image_pool **) Data_custom_val(v))
+
+static void caml_cairo_pool_proxy_free(struct caml_cairo_pool_proxy *p)
+{
+  free(p->proxy.data);
+  free(p);
+}
+
+/* Free the idle buffers of [pool]. */
+static void caml_cairo_image_pool_free_idle
+(struct caml_cairo_image_pool *pool)
+{
+  struct caml_cairo_pool_proxy *p, *next;
+
+  POOL_LOCK(pool);
+  p = pool->idle;
+  pool->idle = NULL;
+  pool->idle_bytes = 0;
+  POOL_UNLOCK(pool);
+  for(; p != NULL; p = next) {
+    next = p->next;
+    caml_cairo_pool_proxy_free(p);
+  }
+}
+
+static void caml_cairo_image_pool_destroy(struct caml_cairo_image_pool *pool)
+{
+  int unused;
+
+  caml_cairo_image_pool_free_idle(pool);
+  POOL_LOCK(pool);
+  pool->closed = 1;
+  unused = (pool->lent == 0);
+  POOL_UNLOCK(pool);
+  if (unused) free(pool);
+}
+
+DEFINE_CUSTOM_OPERATIONS(image_pool, caml_cairo_image_pool_destroy,
+                         IMAGE_POOL_VAL)
 
-static value caml_cairo_surface_kind[15];
+/* The buffer of [proxy] is about to be shared with bigarrays, which
+   free it themselves (see caml_ba_finalize) if they are the last to
+   use it, so it leaves the pool for good. */
+static void caml_cairo_pool_proxy_detach(struct caml_ba_proxy *proxy)
+{
+  struct caml_cairo_image_pool *pool =
+    ((struct caml_cairo_pool_proxy *) proxy)->pool;
+  int unused;
+
+  proxy->size = 0; /* a plain proxy of managed bigarrays */
+  POOL_LOCK(pool);
+  pool->lent--;
+  unused = pool->closed && pool->lent == 0;
+  POOL_UNLOCK(pool);
+  if (unused) free(pool);
+}
+
+/* Give the buffer of [p] (no longer used) back to its pool. */
+static void caml_cairo_image_pool_release(struct caml_cairo_pool_proxy *p)
+{
+  struct caml_cairo_image_pool *pool = p->pool;
+  int kept = 0, unused;
+
+  POOL_LOCK(pool);
+  pool->lent--;
+  if (! pool->closed && pool->idle_bytes + p->bytes <= pool->max_bytes) {
+    p->next = pool->idle;
+    pool->idle = p;
+    pool->idle_bytes += p->bytes;
+    kept = 1;
+  }
+  unused = pool->closed && pool->lent == 0;
+  POOL_UNLOCK(pool);
+  if (! kept) caml_cairo_pool_proxy_free(p);
+  if (unused) free(pool);
+}
+
+
+/* Indexed by cairo_surface_type_t. */
+#define CAML_CAIRO_SURFACE_KINDS 25
+static value caml_cairo_surface_kind[CAML_CAIRO_SURFACE_KINDS];
 
 CAMLexport value caml_cairo_surface_kind_init(value unit)
 {
@@ -134,19 +361,105 @@ CAMLexport value caml_cairo_surface_kind_init(value unit)
   caml_cairo_surface_kind[11] = caml_hash_variant("OS2");
   caml_cairo_surface_kind[12] = caml_hash_variant("Win32_printing");
   caml_cairo_surface_kind[13] = caml_hash_variant("Quartz_image");
-  caml_cairo_surface_kind[14] = caml_hash_variant("Recording");
+  caml_cairo_surface_kind[14] = caml_hash_variant("Script");
+  caml_cairo_surface_kind[15] = caml_hash_variant("Qt");
+  caml_cairo_surface_kind[16] = caml_hash_variant("Recording");
+  caml_cairo_surface_kind[17] = caml_hash_variant("VG");
+  caml_cairo_surface_kind[18] = caml_hash_variant("GL");
+  caml_cairo_surface_kind[19] = caml_hash_variant("DRM");
+  caml_cairo_surface_kind[20] = caml_hash_variant("Tee");
+  caml_cairo_surface_kind[21] = caml_hash_variant("XML");
+  caml_cairo_surface_kind[22] = caml_hash_variant("Skia");
+  caml_cairo_surface_kind[23] = caml_hash_variant("Subsurface");
+  caml_cairo_surface_kind[24] = caml_hash_variant("Cogl");
   return(Val_unit);
 }
 
-#define VAL_SURFACE_KIND(k) caml_cairo_surface_kind[k]
+static value caml_cairo_val_surface_kind(cairo_surface_type_t k)
+{
+  if ((unsigned int) k >= CAML_CAIRO_SURFACE_KINDS)
+    caml_failwith("Cairo.Surface.get_type: unknown surface type. "
+                  "Contact the developers.");
+  return(caml_cairo_surface_kind[k]);
+}
+
+#define VAL_SURFACE_KIND(k) caml_cairo_val_surface_kind(k)
 
 
+/* Type cairo_region_t
+***********************************************************************/
+
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 10, 0)
+#define REGION_ASSIGN(v, x) v = ALLOC(region); REGION_VAL(v) = x
+
+DEFINE_CUSTOM_OPERATIONS(region, cairo_region_destroy, REGION_VAL)
+
+/* Conversion from and to [Region.rectangle] (a record of 4 ints). */
+#define SET_RECTANGLE_INT_VAL(r, v)                                     \
+  (r).x = Int_val(Field(v, 0));                                         \
+  (r).y = Int_val(Field(v, 1));                                         \
+  (r).width = Int_val(Field(v, 2));                                     \
+  (r).height = Int_val(Field(v, 3))
+
+#define RECTANGLE_INT_ASSIGN(v, r)                                      \
+  v = caml_alloc_tuple(4);                                              \
+  Field(v, 0) = Val_int((r).x);                                         \
+  Field(v, 1) = Val_int((r).y);                                         \
+  Field(v, 2) = Val_int((r).width);                                     \
+  Field(v, 3) = Val_int((r).height)
+
+#endif
+
 /* Type cairo_path_t
 ***********************************************************************/
 
-#define PATH_ASSIGN(v, x) v = ALLOC(path); PATH_VAL(v) = x
+/* The custom block of a path also holds the proxy shared with the
+   bigarrays viewing its data (see caml_cairo_path_to_bigarray).  When
+   it exists, the proxy owns [path->data].  The first field being the
+   path, PATH_VAL is unchanged. */
+struct caml_cairo_path {
+  cairo_path_t *path;
+  struct caml_ba_proxy *proxy;
+};
+
+#define PATH_PROXY(v) (((struct caml_cairo_path *) Data_custom_val(v))->proxy)
+
+#define PATH_MEM(x)                                                     \
+  (sizeof(cairo_path_t) + (mlsize_t) (x)->num_data * sizeof(cairo_path_data_t))
 
-DEFINE_CUSTOM_OPERATIONS(path, cairo_path_destroy, PATH_VAL)
+#define PATH_ASSIGN(v, x)                                               \
+  v = ALLOC_MEM(path, sizeof(struct caml_cairo_path), PATH_MEM(x));     \
+  PATH_VAL(v) = x;                                                      \
+  PATH_PROXY(v) = NULL
+
+/* Value of destroyed paths (see caml_cairo_path_destroy). */
+static cairo_path_t caml_cairo_path_destroyed =
+  { CAIRO_STATUS_NULL_POINTER, NULL, 0 };
+
+static void caml_cairo_path_finalize(value v)
+{
+  cairo_path_t *path = PATH_VAL(v);
+  struct caml_ba_proxy *proxy = PATH_PROXY(v);
+
+  if (path == &caml_cairo_path_destroyed) return;
+  if (proxy != NULL) {
+    path->data = NULL; /* so cairo_path_destroy does not free it */
+    if (PROXY_DECR(proxy) == 0) {
+      free(proxy->data);
+      free(proxy);
+    }
+  }
+  cairo_path_destroy(path);
+}
+
+CUSTOM_OPERATIONS(path)
+
+static cairo_path_t * caml_cairo_path_ok(value vpath)
+{
+  cairo_path_t *path = PATH_VAL(vpath);
+  caml_cairo_raise_Error(path->status);
+  return(path);
+}
 
 
 /* Type cairo_glyph_t
@@ -190,6 +503,65 @@ DEFINE_CUSTOM_OPERATIONS(path, cairo_path_destroy, PATH_VAL)
 #define CLUSTER_FLAGS_VAL(v) ((cairo_text_cluster_flags_t) Int_val(v))
 #define VAL_CLUSTER_FLAGS(v) Val_int(v)
 
+/* Glyph.Buffer.t: growable array of glyphs (and the clusters mapping
+   them to text) owned by C so that it can be passed to Cairo without
+   conversion. */
+struct caml_cairo_glyph_buffer {
+  cairo_glyph_t *glyphs;
+  int num_glyphs;
+  int capacity;
+  cairo_text_cluster_t *clusters;
+  int num_clusters;
+  int clusters_capacity;
+  cairo_text_cluster_flags_t cluster_flags;
+};
+
+#define GLYPH_BUFFER_VAL(v) \
+  (* (struct caml_cairo_glyph_buffer **) Data_custom_val(v))
+
+static void caml_cairo_glyph_buffer_destroy(struct caml_cairo_glyph_buffer *b)
+{
+  free(b->glyphs);
+  free(b->clusters);
+  free(b);
+}
+
+DEFINE_CUSTOM_OPERATIONS(glyph_buffer, caml_cairo_glyph_buffer_destroy,
+                         GLYPH_BUFFER_VAL)
+
+/* Make sure [b] can hold [n] glyphs.  Return 0 if out of memory. */
+static int caml_cairo_glyph_buffer_reserve(struct caml_cairo_glyph_buffer *b,
+                                           int n)
+{
+  int capacity;
+  cairo_glyph_t *glyphs;
+
+  if (n <= b->capacity) return(1);
+  capacity = (b->capacity < 16) ? 16 : b->capacity;
+  while (capacity < n) capacity *= 2;
+  glyphs = realloc(b->glyphs, capacity * sizeof(cairo_glyph_t));
+  if (glyphs == NULL) return(0);
+  b->glyphs = glyphs;
+  b->capacity = capacity;
+  return(1);
+}
+
+static int caml_cairo_glyph_buffer_reserve_clusters
+(struct caml_cairo_glyph_buffer *b, int n)
+{
+  int capacity;
+  cairo_text_cluster_t *clusters;
+
+  if (n <= b->clusters_capacity) return(1);
+  capacity = (b->clusters_capacity < 16) ? 16 : b->clusters_capacity;
+  while (capacity < n) capacity *= 2;
+  clusters = realloc(b->clusters, capacity * sizeof(cairo_text_cluster_t));
+  if (clusters == NULL) return(0);
+  b->clusters = clusters;
+  b->clusters_capacity = capacity;
+  return(1);
+}
+
 /* Type cairo_matrix_t
 ***********************************************************************/
 
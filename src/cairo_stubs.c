@@ -16,6 +16,7 @@
    LICENSE for more details. */
 
 #include <string.h>
+#include <stdint.h>
 #include <cairo.h>
 #include <cairo-pdf.h>
 #include <cairo-ps.h>
@@ -30,6 +31,7 @@
 #include <caml/custom.h>
 #include <caml/intext.h>
 #include <caml/bigarray.h>
+#include <caml/version.h>
 
 #include "cairo_macros.h"
 #include "cairo_ocaml_types.h"
@@ -54,6 +56,21 @@ CAMLexport value caml_cairo_create(value vsurf)
   CAMLreturn(vcontext);
 }
 
+/* Destroying a value replaces the Cairo object by an object "in
+   error" so any subsequent use reports an error through the usual
+   status checks (and the finalizer has nothing to release). */
+
+CAMLexport value caml_cairo_destroy(value vcr)
+{
+  /* noalloc */
+  cairo_t *cr = CAIRO_VAL(vcr);
+  /* Cairo returns a static context with status CAIRO_STATUS_NULL_POINTER
+     (CAIRO_STATUS_NO_MEMORY before 1.12). */
+  CAIRO_VAL(vcr) = cairo_create(NULL);
+  cairo_destroy(cr);
+  return(Val_unit);
+}
+
 DO_CONTEXT(cairo_save)
 DO_CONTEXT(cairo_restore)
 
@@ -117,9 +134,10 @@ DO3_CONTEXT(cairo_set_source_rgb, Double_val, Double_val, Double_val)
 DO4_CONTEXT(cairo_set_source_rgba, Double_val, Double_val,
              Double_val, Double_val)
 
-DO3_CONTEXT(cairo_set_source_surface, SURFACE_VAL, Double_val, Double_val)
+DO3_CONTEXT(cairo_set_source_surface, caml_cairo_surface_ok,
+            Double_val, Double_val)
 
-DO1_CONTEXT(cairo_set_source, PATTERN_VAL)
+DO1_CONTEXT(cairo_set_source, caml_cairo_pattern_ok)
 
 
 CAMLexport value caml_cairo_get_source(value vcr)
@@ -253,8 +271,8 @@ CAMLexport value caml_cairo_copy_clip_rectangle_list(value vcr)
 }
 
 
-DO_CONTEXT(cairo_fill)
-DO_CONTEXT(cairo_fill_preserve)
+DO_CONTEXT_BLOCKING(cairo_fill)
+DO_CONTEXT_BLOCKING(cairo_fill_preserve)
 
 GET_EXTENTS(cairo_fill_extents)
 
@@ -268,23 +286,44 @@ CAMLexport value caml_cairo_in_fill(value vcr, value vx, value vy)
   CAMLreturn(Val_int(b));
 }
 
-DO1_CONTEXT(cairo_mask, PATTERN_VAL)
+CAMLexport value caml_cairo_mask(value vcr, value vpat)
+{
+  CAMLparam2(vcr, vpat);
+  cairo_t* cr = CAIRO_VAL(vcr);
+  cairo_pattern_t *pat = caml_cairo_pattern_ok(vpat);
+  WITHOUT_RUNTIME_LOCK(cairo_get_target(cr), cairo_mask(cr, pat));
+  caml_check_status(cr);
+  CAMLreturn(Val_unit);
+}
 
 CAMLexport value caml_cairo_mask_surface(value vcr, value vsurf,
                                          value vx, value vy)
 {
   CAMLparam4(vcr, vsurf, vx, vy);
   cairo_t* cr = CAIRO_VAL(vcr);
-  cairo_mask_surface(cr, SURFACE_VAL(vsurf), Double_val(vx), Double_val(vy));
+  cairo_surface_t *surf = caml_cairo_surface_ok(vsurf);
+  double x = Double_val(vx), y = Double_val(vy);
+  WITHOUT_RUNTIME_LOCK(cairo_get_target(cr),
+                       cairo_mask_surface(cr, surf, x, y));
   caml_check_status(cr);
   CAMLreturn(Val_unit);
 }
 
-DO_CONTEXT(cairo_paint)
-DO1_CONTEXT(cairo_paint_with_alpha, Double_val)
+DO_CONTEXT_BLOCKING(cairo_paint)
+
+CAMLexport value caml_cairo_paint_with_alpha(value vcr, value valpha)
+{
+  CAMLparam2(vcr, valpha);
+  cairo_t* cr = CAIRO_VAL(vcr);
+  double alpha = Double_val(valpha);
+  WITHOUT_RUNTIME_LOCK(cairo_get_target(cr),
+                       cairo_paint_with_alpha(cr, alpha));
+  caml_check_status(cr);
+  CAMLreturn(Val_unit);
+}
 
-DO_CONTEXT(cairo_stroke)
-DO_CONTEXT(cairo_stroke_preserve)
+DO_CONTEXT_BLOCKING(cairo_stroke)
+DO_CONTEXT_BLOCKING(cairo_stroke_preserve)
 
 GET_EXTENTS(cairo_stroke_extents)
 
@@ -298,8 +337,43 @@ CAMLexport value caml_cairo_in_stroke(value vcr, value vx, value vy)
   CAMLreturn(Val_int(b));
 }
 
-DO_CONTEXT(cairo_copy_page)
-DO_CONTEXT(cairo_show_page)
+/* Hit testing of many points at once.  [vpts] holds the points as
+   [x0, y0, x1, y1,...] and [vres] receives 0 or 1 for each point; the
+   lengths are checked on the OCaml side.  The status is only checked
+   at the end (cairo returns FALSE for all points if [cr] is in
+   error). */
+static void caml_cairo_in_many(cairo_t *cr,
+                               cairo_bool_t (*in)(cairo_t *, double, double),
+                               value vpts, value vres)
+{
+  const double *pts = (double *) Caml_ba_data_val(vpts);
+  unsigned char *res = (unsigned char *) Caml_ba_data_val(vres);
+  intnat i, n = Caml_ba_array_val(vres)->dim[0];
+
+  WITHOUT_RUNTIME_LOCK(cairo_get_target(cr),
+                       for(i = 0; i < n; i++)
+                         res[i] = in(cr, pts[2 * i], pts[2 * i + 1]) != 0);
+  caml_check_status(cr);
+}
+
+#define IN_MANY(name)                                                   \
+  CAMLexport value caml_##name##_many(value vcr, value vpts, value vres) \
+  {                                                                     \
+    CAMLparam3(vcr, vpts, vres);                                        \
+    caml_cairo_in_many(CAIRO_VAL(vcr), &name, vpts, vres);              \
+    CAMLreturn(Val_unit);                                               \
+  }
+
+IN_MANY(cairo_in_fill)
+IN_MANY(cairo_in_stroke)
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 10, 0)
+IN_MANY(cairo_in_clip)
+#else
+UNAVAILABLE3(cairo_in_clip_many)
+#endif
+
+DO_CONTEXT_BLOCKING(cairo_copy_page)
+DO_CONTEXT_BLOCKING(cairo_show_page)
 
 
 /* Paths -- Creating paths and manipulating path data
@@ -325,7 +399,16 @@ CAMLexport value caml_cairo_copy_path_flat(value vcr)
   CAMLreturn(vpath);
 }
 
-DO1_CONTEXT(cairo_append_path, PATH_VAL)
+CAMLexport value caml_cairo_path_destroy(value vpath)
+{
+  /* noalloc */
+  caml_cairo_path_finalize(vpath);
+  PATH_VAL(vpath) = &caml_cairo_path_destroyed;
+  PATH_PROXY(vpath) = NULL;
+  return(Val_unit);
+}
+
+DO1_CONTEXT(cairo_append_path, caml_cairo_path_ok)
 
 CAMLexport value caml_cairo_get_current_point(value vcr)
 {
@@ -363,20 +446,56 @@ CAMLexport value caml_cairo_glyph_path(value vcr, value vglyphs)
 DO1_CONTEXT(cairo_text_path, String_val)
 GET_EXTENTS(cairo_path_extents)
 
-DO5_CONTEXT(cairo_arc, Double_val, Double_val, Double_val, Double_val,
-             Double_val)
-DO5_CONTEXT(cairo_arc_negative, Double_val, Double_val, Double_val,
-             Double_val, Double_val)
-DO6_CONTEXT(cairo_curve_to, Double_val, Double_val, Double_val,
-             Double_val, Double_val, Double_val)
-DO2_CONTEXT(cairo_line_to, Double_val, Double_val)
-DO2_CONTEXT(cairo_move_to, Double_val, Double_val)
-DO4_CONTEXT(cairo_rectangle, Double_val, Double_val, Double_val, Double_val)
+DO5_CONTEXT_UNBOXED(cairo_arc)
+DO5_CONTEXT_UNBOXED(cairo_arc_negative)
+DO6_CONTEXT_UNBOXED(cairo_curve_to)
+DO2_CONTEXT_UNBOXED(cairo_line_to)
+DO2_CONTEXT_UNBOXED(cairo_move_to)
+DO4_CONTEXT_UNBOXED(cairo_rectangle)
+
+DO6_CONTEXT_UNBOXED(cairo_rel_curve_to)
+DO2_CONTEXT_UNBOXED(cairo_rel_line_to)
+DO2_CONTEXT_UNBOXED(cairo_rel_move_to)
+
+/* Bulk submission of points given as x0, y0, x1, y1,... in a float64
+   bigarray.  The length of the bigarray is checked on the OCaml side. */
+
+CAMLexport value caml_cairo_path_lines_of_bigarray(value vcr, value vb,
+                                                   value vclosed)
+{
+  /* noalloc */
+  cairo_t *cr = CAIRO_VAL(vcr);
+  double *p = (double *) Caml_ba_data_val(vb);
+  intnat i, n = Caml_ba_array_val(vb)->dim[0];
+
+  if (n >= 2) {
+    cairo_move_to(cr, p[0], p[1]);
+    for(i = 2; i < n; i += 2)
+      cairo_line_to(cr, p[i], p[i + 1]);
+    if (Bool_val(vclosed)) cairo_close_path(cr);
+  }
+  caml_check_status(cr);
+  return(Val_unit);
+}
 
-DO6_CONTEXT(cairo_rel_curve_to, Double_val, Double_val, Double_val,
-             Double_val, Double_val, Double_val)
-DO2_CONTEXT(cairo_rel_line_to, Double_val, Double_val)
-DO2_CONTEXT(cairo_rel_move_to, Double_val, Double_val)
+CAMLexport value caml_cairo_path_curves_of_bigarray(value vcr, value vb,
+                                                    value vclosed)
+{
+  /* noalloc */
+  cairo_t *cr = CAIRO_VAL(vcr);
+  double *p = (double *) Caml_ba_data_val(vb);
+  intnat i, n = Caml_ba_array_val(vb)->dim[0];
+
+  if (n >= 2) {
+    cairo_move_to(cr, p[0], p[1]);
+    for(i = 2; i < n; i += 6)
+      cairo_curve_to(cr, p[i], p[i + 1], p[i + 2], p[i + 3],
+                     p[i + 4], p[i + 5]);
+    if (Bool_val(vclosed)) cairo_close_path(cr);
+  }
+  caml_check_status(cr);
+  return(Val_unit);
+}
 
 
 /* Interacting with the paths content from OCaml. */
@@ -481,10 +600,140 @@ CAMLexport value caml_cairo_path_of_array(value varray)
   CAMLreturn(vpath);
 }
 
+/* Packed representation: a [num_data × 2] float64 bigarray viewing
+   the cairo_path_data_t array (each element is 2 doubles wide).  The
+   rows holding a header are accessed with the functions below. */
+
+CAMLexport value caml_cairo_path_to_bigarray(value vpath)
+{
+  CAMLparam1(vpath);
+  CAMLlocal1(vb);
+  cairo_path_t *path = PATH_VAL(vpath);
+  struct caml_ba_proxy *proxy = PATH_PROXY(vpath);
+  intnat dim[2];
+
+  dim[0] = path->num_data;
+  dim[1] = 2;
+  if (path->data == NULL) /* empty path, nothing to share */
+    CAMLreturn(caml_ba_alloc(CAML_BA_FLOAT64 | CAML_BA_C_LAYOUT, 2,
+                             NULL, dim));
+  if (proxy == NULL) {
+    /* First view: the data is now owned by a proxy shared by the path
+       and the bigarrays (adapted from caml_ba_update_proxy). */
+    proxy = malloc(sizeof(struct caml_ba_proxy));
+    if (proxy == NULL) caml_raise_out_of_memory();
+    proxy->refcount = 1; /* path */
+    proxy->data = path->data;
+    proxy->size = 0;
+    PATH_PROXY(vpath) = proxy;
+  }
+  vb = caml_ba_alloc(CAML_BA_FLOAT64 | CAML_BA_C_LAYOUT | CAML_BA_MANAGED,
+                     2, path->data, dim);
+  PROXY_INCR(proxy);
+  (Caml_ba_array_val(vb))->proxy = proxy;
+  CAMLreturn(vb);
+}
+
+/* Check that [data] is a sequence of well formed path elements. */
+static int caml_cairo_path_data_valid(cairo_path_data_t *data, int num_data)
+{
+  int i = 0;
+  while (i < num_data) {
+    switch (data[i].header.type) {
+    case CAIRO_PATH_MOVE_TO:
+    case CAIRO_PATH_LINE_TO:
+      if (data[i].header.length != 2) return(0);
+      break;
+    case CAIRO_PATH_CURVE_TO:
+      if (data[i].header.length != 4) return(0);
+      break;
+    case CAIRO_PATH_CLOSE_PATH:
+      if (data[i].header.length != 1) return(0);
+      break;
+    default:
+      return(0);
+    }
+    i += data[i].header.length;
+  }
+  return(i == num_data);
+}
+
+CAMLexport value caml_cairo_path_of_bigarray(value vb)
+{
+  CAMLparam1(vb);
+  CAMLlocal1(vpath);
+  cairo_path_data_t *data = (cairo_path_data_t *) Caml_ba_data_val(vb);
+  int num_data = Caml_ba_array_val(vb)->dim[0];
+  cairo_path_t* path;
+
+  if (! caml_cairo_path_data_valid(data, num_data))
+    caml_cairo_raise_Error(CAIRO_STATUS_INVALID_PATH_DATA);
+  /* Copy the data so later modifications of the bigarray cannot make
+     the path invalid. */
+  SET_MALLOC(path, 1, cairo_path_t);
+  path->status = CAIRO_STATUS_SUCCESS;
+  path->num_data = num_data;
+  path->data = NULL;
+  if (num_data > 0) {
+    path->data = malloc(num_data * sizeof(cairo_path_data_t));
+    if (path->data == NULL) {
+      free(path);
+      caml_raise_out_of_memory();
+    }
+    memcpy(path->data, data, num_data * sizeof(cairo_path_data_t));
+  }
+  PATH_ASSIGN(vpath, path);
+  CAMLreturn(vpath);
+}
+
+#define PATH_DATA_ROW(vb, vi) \
+  (((cairo_path_data_t *) Caml_ba_data_val(vb))[Long_val(vi)])
+
+CAMLexport value caml_cairo_path_data_get_type(value vb, value vi)
+{
+  /* Does not allocate but may raise. */
+  cairo_path_data_type_t ty = PATH_DATA_ROW(vb, vi).header.type;
+  /* keep in sync the tags with the OCaml def of Path.element_type */
+  if (ty < CAIRO_PATH_MOVE_TO || ty > CAIRO_PATH_CLOSE_PATH)
+    caml_invalid_argument("Cairo.Path.get_type: not a header");
+  return(Val_int(ty));
+}
+
+CAMLexport value caml_cairo_path_data_get_length(value vb, value vi)
+{
+  /* noalloc */
+  return(Val_int(PATH_DATA_ROW(vb, vi).header.length));
+}
+
+CAMLexport value caml_cairo_path_data_set_header(value vb, value vi,
+                                                 value vtype)
+{
+  /* noalloc */
+  cairo_path_data_t *data = &PATH_DATA_ROW(vb, vi);
+  data->header.type = (cairo_path_data_type_t) Int_val(vtype);
+  switch (data->header.type) {
+  case CAIRO_PATH_MOVE_TO:
+  case CAIRO_PATH_LINE_TO:    data->header.length = 2;  break;
+  case CAIRO_PATH_CURVE_TO:   data->header.length = 4;  break;
+  case CAIRO_PATH_CLOSE_PATH: data->header.length = 1;  break;
+  }
+  return(Val_unit);
+}
+
 
 /* Patterns -- Sources for drawing
 ***********************************************************************/
 
+CAMLexport value caml_cairo_pattern_destroy(value vpat)
+{
+  /* noalloc */
+  cairo_pattern_t *pat = PATTERN_VAL(vpat);
+  /* Static pattern with status CAIRO_STATUS_NULL_POINTER. */
+  PATTERN_VAL(vpat) = cairo_pattern_create_for_surface(NULL);
+  cairo_pattern_destroy(pat);
+  return(Val_unit);
+}
+
 CAMLexport value caml_cairo_pattern_add_color_stop_rgb
 (value vpat, value vofs, value vr, value vg, value vb)
 {
@@ -589,7 +838,8 @@ CAMLexport value caml_cairo_pattern_create_for_surface(value vsurf)
 {
   CAMLparam1(vsurf);
   CAMLlocal1(vpat);
-  cairo_pattern_t* pat = cairo_pattern_create_for_surface(SURFACE_VAL(vsurf));
+  cairo_pattern_t* pat =
+    cairo_pattern_create_for_surface(caml_cairo_surface_ok(vsurf));
   caml_cairo_raise_Error(cairo_pattern_status(pat));
   PATTERN_ASSIGN(vpat, pat);
   CAMLreturn(vpat);
@@ -720,6 +970,299 @@ CAMLexport value caml_cairo_pattern_get_matrix(value vpat)
   CAMLreturn(vmat);
 }
 
+/* Mesh patterns (Cairo >= 1.12).  The construction functions check
+   the status of the pattern so that errors are reported where they
+   occur rather than when the pattern is used. */
+
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 12, 0)
+
+CAMLexport value caml_cairo_pattern_create_mesh(value unit)
+{
+  CAMLparam1(unit);
+  CAMLlocal1(vpat);
+  cairo_pattern_t* pat = cairo_pattern_create_mesh();
+  caml_cairo_raise_Error(cairo_pattern_status(pat));
+  PATTERN_ASSIGN(vpat, pat);
+  CAMLreturn(vpat);
+}
+
+#define MESH_DO(name)                                                   \
+  CAMLexport value caml_cairo_mesh_pattern_##name(value vpat)           \
+  {                                                                     \
+    CAMLparam1(vpat);                                                   \
+    cairo_pattern_t* pat = PATTERN_VAL(vpat);                           \
+    cairo_mesh_pattern_##name(pat);                                     \
+    caml_cairo_raise_Error(cairo_pattern_status(pat));                  \
+    CAMLreturn(Val_unit);                                               \
+  }
+
+#define MESH_DO_XY(name)                                                \
+  CAMLexport value caml_cairo_mesh_pattern_##name(value vpat,           \
+                                                  value vx, value vy)   \
+  {                                                                     \
+    CAMLparam3(vpat, vx, vy);                                           \
+    cairo_pattern_t* pat = PATTERN_VAL(vpat);                           \
+    cairo_mesh_pattern_##name(pat, Double_val(vx), Double_val(vy));     \
+    caml_cairo_raise_Error(cairo_pattern_status(pat));                  \
+    CAMLreturn(Val_unit);                                               \
+  }
+
+MESH_DO(begin_patch)
+MESH_DO(end_patch)
+MESH_DO_XY(move_to)
+MESH_DO_XY(line_to)
+
+CAMLexport value caml_cairo_mesh_pattern_curve_to
+(value vpat, value vx1, value vy1, value vx2, value vy2, value vx3, value vy3)
+{
+  CAMLparam5(vpat, vx1, vy1, vx2, vy2);
+  CAMLxparam2(vx3, vy3);
+  cairo_pattern_t* pat = PATTERN_VAL(vpat);
+  cairo_mesh_pattern_curve_to(pat, Double_val(vx1), Double_val(vy1),
+                              Double_val(vx2), Double_val(vy2),
+                              Double_val(vx3), Double_val(vy3));
+  caml_cairo_raise_Error(cairo_pattern_status(pat));
+  CAMLreturn(Val_unit);
+}
+
+CAMLexport value caml_cairo_mesh_pattern_curve_to_bc(value * argv, int argn)
+{
+  return caml_cairo_mesh_pattern_curve_to(argv[0], argv[1], argv[2], argv[3],
+                                          argv[4], argv[5], argv[6]);
+}
+
+CAMLexport value caml_cairo_mesh_pattern_set_control_point
+(value vpat, value vi, value vx, value vy)
+{
+  CAMLparam4(vpat, vi, vx, vy);
+  cairo_pattern_t* pat = PATTERN_VAL(vpat);
+  cairo_mesh_pattern_set_control_point(pat, Int_val(vi), Double_val(vx),
+                                       Double_val(vy));
+  caml_cairo_raise_Error(cairo_pattern_status(pat));
+  CAMLreturn(Val_unit);
+}
+
+CAMLexport value caml_cairo_mesh_pattern_set_corner_color_rgba
+(value vpat, value vi, value vr, value vg, value vb, value va)
+{
+  CAMLparam5(vpat, vi, vr, vg, vb);
+  CAMLxparam1(va);
+  cairo_pattern_t* pat = PATTERN_VAL(vpat);
+  cairo_mesh_pattern_set_corner_color_rgba(pat, Int_val(vi), Double_val(vr),
+                                           Double_val(vg), Double_val(vb),
+                                           Double_val(va));
+  caml_cairo_raise_Error(cairo_pattern_status(pat));
+  CAMLreturn(Val_unit);
+}
+
+CAMLexport value caml_cairo_mesh_pattern_set_corner_color_rgba_bc
+(value * argv, int argn)
+{
+  return caml_cairo_mesh_pattern_set_corner_color_rgba
+    (argv[0], argv[1], argv[2], argv[3], argv[4], argv[5]);
+}
+
+CAMLexport value caml_cairo_mesh_pattern_get_patch_count(value vpat)
+{
+  CAMLparam1(vpat);
+  unsigned int count;
+  caml_cairo_raise_Error(cairo_mesh_pattern_get_patch_count(PATTERN_VAL(vpat),
+                                                            &count));
+  CAMLreturn(Val_int(count));
+}
+
+CAMLexport value caml_cairo_mesh_pattern_get_control_point
+(value vpat, value vpatch, value vi)
+{
+  CAMLparam3(vpat, vpatch, vi);
+  CAMLlocal1(vcouple);
+  double x, y;
+  caml_cairo_raise_Error(cairo_mesh_pattern_get_control_point
+                         (PATTERN_VAL(vpat), Int_val(vpatch), Int_val(vi),
+                          &x, &y));
+  vcouple = caml_alloc_tuple(2);
+  Store_field(vcouple, 0, caml_copy_double(x));
+  Store_field(vcouple, 1, caml_copy_double(y));
+  CAMLreturn(vcouple);
+}
+
+CAMLexport value caml_cairo_mesh_pattern_get_corner_color_rgba
+(value vpat, value vpatch, value vi)
+{
+  CAMLparam3(vpat, vpatch, vi);
+  CAMLlocal1(vcolor);
+  double r, g, b, a;
+  caml_cairo_raise_Error(cairo_mesh_pattern_get_corner_color_rgba
+                         (PATTERN_VAL(vpat), Int_val(vpatch), Int_val(vi),
+                          &r, &g, &b, &a));
+  vcolor = caml_alloc_tuple(4);
+  Store_field(vcolor, 0, caml_copy_double(r));
+  Store_field(vcolor, 1, caml_copy_double(g));
+  Store_field(vcolor, 2, caml_copy_double(b));
+  Store_field(vcolor, 3, caml_copy_double(a));
+  CAMLreturn(vcolor);
+}
+
+/* Add patches with straight sides.  Each patch has [vsides] (3 or 4)
+   corners, given as x, y in [vpts] and as r, g, b, a in [vcolors].
+   The lengths of the bigarrays are checked on the OCaml side. */
+CAMLexport value caml_cairo_mesh_pattern_add_patches
+(value vpat, value vsides, value vpts, value vcolors)
+{
+  CAMLparam4(vpat, vsides, vpts, vcolors);
+  cairo_pattern_t* pat = PATTERN_VAL(vpat);
+  int sides = Int_val(vsides);
+  const double *pts = (double *) Caml_ba_data_val(vpts);
+  const double *colors = (double *) Caml_ba_data_val(vcolors);
+  intnat n = Caml_ba_array_val(vpts)->dim[0] / (2 * sides);
+  intnat p;
+  int i;
+
+  for(p = 0; p < n; p++) {
+    cairo_mesh_pattern_begin_patch(pat);
+    cairo_mesh_pattern_move_to(pat, pts[0], pts[1]);
+    for(i = 1; i < sides; i++)
+      cairo_mesh_pattern_line_to(pat, pts[2 * i], pts[2 * i + 1]);
+    for(i = 0; i < sides; i++)
+      cairo_mesh_pattern_set_corner_color_rgba(pat, i, colors[4 * i],
+                                               colors[4 * i + 1],
+                                               colors[4 * i + 2],
+                                               colors[4 * i + 3]);
+    cairo_mesh_pattern_end_patch(pat);
+    pts += 2 * sides;
+    colors += 4 * sides;
+  }
+  caml_cairo_raise_Error(cairo_pattern_status(pat));
+  CAMLreturn(Val_unit);
+}
+
+#else
+
+UNAVAILABLE1(cairo_pattern_create_mesh)
+UNAVAILABLE1(cairo_mesh_pattern_begin_patch)
+UNAVAILABLE1(cairo_mesh_pattern_end_patch)
+UNAVAILABLE3(cairo_mesh_pattern_move_to)
+UNAVAILABLE3(cairo_mesh_pattern_line_to)
+RAISE_UNAVAILABLE(cairo_mesh_pattern_curve_to_bc, value * argv, int argn)
+RAISE_UNAVAILABLE(cairo_mesh_pattern_curve_to, value v1, value v2, value v3,
+                  value v4, value v5, value v6, value v7)
+UNAVAILABLE4(cairo_mesh_pattern_set_control_point)
+RAISE_UNAVAILABLE(cairo_mesh_pattern_set_corner_color_rgba_bc,
+                  value * argv, int argn)
+RAISE_UNAVAILABLE(cairo_mesh_pattern_set_corner_color_rgba, value v1,
+                  value v2, value v3, value v4, value v5, value v6)
+UNAVAILABLE1(cairo_mesh_pattern_get_patch_count)
+UNAVAILABLE3(cairo_mesh_pattern_get_control_point)
+UNAVAILABLE3(cairo_mesh_pattern_get_corner_color_rgba)
+UNAVAILABLE4(cairo_mesh_pattern_add_patches)
+
+#endif
+
+/* Raster sources (Cairo >= 1.12).  The callback data is a pointer to
+   the OCaml pair (acquire, release option), registered as a root and
+   freed with the pattern. */
+
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 12, 0)
+
+static const cairo_user_data_key_t raster_source_callbacks;
+
+static cairo_surface_t *
+caml_cairo_raster_source_acquire(cairo_pattern_t *pattern,
+                                 void *callback_data,
+                                 cairo_surface_t *target,
+                                 const cairo_rectangle_int_t *extents)
+{
+  CALLBACK_LEAVE_BLOCKING(released);
+  CAMLparam0();
+  CAMLlocal1(vtarget);
+  value args[5], res;
+  cairo_surface_t *surf = NULL;
+
+  SURFACE_ASSIGN(vtarget, cairo_surface_reference(target));
+  args[0] = vtarget;
+  args[1] = Val_int(extents->x);
+  args[2] = Val_int(extents->y);
+  args[3] = Val_int(extents->width);
+  args[4] = Val_int(extents->height);
+  res = caml_callbackN_exn(Field(* (value *) callback_data, 0), 5, args);
+  /* Exceptions cannot go through Cairo: nothing is drawn.  Cairo uses
+     the result as an image without checking it, so other surfaces
+     (including destroyed and erroneous ones) are treated likewise. */
+  if (! Is_exception_result(res)) {
+    surf = SURFACE_VAL(res);
+    if (cairo_surface_get_type(surf) == CAIRO_SURFACE_TYPE_IMAGE
+        && cairo_surface_status(surf) == CAIRO_STATUS_SUCCESS
+        && surf != caml_cairo_surface_destroyed)
+      cairo_surface_reference(surf);
+    else
+      surf = NULL;
+  }
+  CALLBACK_ENTER_BLOCKING(released);
+  CAMLreturnT(cairo_surface_t *, surf);
+}
+
+static void caml_cairo_raster_source_release(cairo_pattern_t *pattern,
+                                             void *callback_data,
+                                             cairo_surface_t *surface)
+{
+  CALLBACK_LEAVE_BLOCKING(released);
+  CAMLparam0();
+  CAMLlocal2(vrelease, vsurf);
+  vrelease = Field(* (value *) callback_data, 1);
+  if (Is_block(vrelease)) /* = Some _ */ {
+    SURFACE_ASSIGN(vsurf, cairo_surface_reference(surface));
+    caml_callback_exn(Field(vrelease, 0), vsurf);
+  }
+  cairo_surface_destroy(surface); /* reference taken by acquire */
+  CALLBACK_ENTER_BLOCKING(released);
+  CAMLreturn0;
+}
+
+CAMLexport value caml_cairo_pattern_create_raster_source
+(value vcontent, value vw, value vh, value vacquire, value vrelease)
+{
+  CAMLparam5(vcontent, vw, vh, vacquire, vrelease);
+  CAMLlocal2(vpat, vcallbacks);
+  cairo_content_t content;
+  cairo_pattern_t *pat;
+  cairo_status_t status;
+  value *callbacks;
+
+  SET_CONTENT_VAL(content, vcontent);
+  vcallbacks = caml_alloc_tuple(2);
+  Store_field(vcallbacks, 0, vacquire);
+  Store_field(vcallbacks, 1, vrelease);
+  SET_MALLOC(callbacks, 1, value);
+  *callbacks = vcallbacks;
+  pat = cairo_pattern_create_raster_source(callbacks, content,
+                                           Int_val(vw), Int_val(vh));
+  status = cairo_pattern_status(pat);
+  if (status == CAIRO_STATUS_SUCCESS) {
+    caml_register_generational_global_root(callbacks);
+    status = cairo_pattern_set_user_data(pat, &raster_source_callbacks,
+                                         callbacks,
+                                         &caml_destroy_surface_callback);
+    if (status != CAIRO_STATUS_SUCCESS)
+      caml_remove_generational_global_root(callbacks);
+  }
+  if (status != CAIRO_STATUS_SUCCESS) {
+    free(callbacks);
+    cairo_pattern_destroy(pat);
+    caml_cairo_raise_Error(status);
+  }
+  cairo_raster_source_pattern_set_acquire(pat,
+                                          &caml_cairo_raster_source_acquire,
+                                          &caml_cairo_raster_source_release);
+  PATTERN_ASSIGN(vpat, pat);
+  CAMLreturn(vpat);
+}
+
+#else
+
+UNAVAILABLE5(cairo_pattern_create_raster_source)
+
+#endif
+
 
 /* Transformations - Manipulating the current transformation matrix
 ***********************************************************************/
@@ -775,6 +1318,85 @@ COORD_TRANSFORM(cairo_user_to_device_distance)
 COORD_TRANSFORM(cairo_device_to_user)
 COORD_TRANSFORM(cairo_device_to_user_distance)
 
+/* Transform the [n] points [src] = [x0, y0, x1, y1,...] into [dst]
+   (which may be [src]).  The translation is ignored for distances.
+   Simple loops so that the compiler can vectorize them. */
+static void caml_cairo_transform_points(const cairo_matrix_t *m, int distance,
+                                        const double *src, double *dst,
+                                        intnat n)
+{
+  const double xx = m->xx, yx = m->yx, xy = m->xy, yy = m->yy;
+  const double x0 = distance ? 0. : m->x0, y0 = distance ? 0. : m->y0;
+  double x, y;
+  intnat i;
+
+  for(i = 0; i < 2 * n; i += 2) {
+    x = src[i];
+    y = src[i + 1];
+    dst[i] = xx * x + xy * y + x0;
+    dst[i + 1] = yx * x + yy * y + y0;
+  }
+}
+
+/* The lengths of the bigarrays are checked on the OCaml side. */
+#define MATRIX_TRANSFORM_POINTS(name, distance)                         \
+  CAMLexport value caml_cairo_matrix_##name(value vmatrix, value vsrc,  \
+                                            value vdst)                 \
+  {                                                                     \
+    /* noalloc */                                                       \
+    ALLOC_CAIRO_MATRIX(vmatrix);                                        \
+    caml_cairo_transform_points(GET_MATRIX(vmatrix), distance,          \
+                                (double *) Caml_ba_data_val(vsrc),      \
+                                (double *) Caml_ba_data_val(vdst),      \
+                                Caml_ba_array_val(vsrc)->dim[0] / 2);   \
+    return(Val_unit);                                                   \
+  }
+
+MATRIX_TRANSFORM_POINTS(transform_points, 0)
+MATRIX_TRANSFORM_POINTS(transform_distances, 1)
+
+/* The affine map of [name] (which includes the device transformation
+   of the target, unlike the CTM) is recovered from the images of the
+   origin and of the unit vectors. */
+#define COORD_TRANSFORM_POINTS(name, distance)                          \
+  CAMLexport value caml_##name##_points(value vcr, value vsrc, value vdst) \
+  {                                                                     \
+    /* noalloc */                                                       \
+    cairo_t* cr = CAIRO_VAL(vcr);                                       \
+    cairo_matrix_t m;                                                   \
+    m.x0 = 0.;  m.y0 = 0.;                                              \
+    name(cr, &m.x0, &m.y0);                                             \
+    m.xx = 1.;  m.yx = 0.;                                              \
+    name##_distance(cr, &m.xx, &m.yx);                                  \
+    m.xy = 0.;  m.yy = 1.;                                              \
+    name##_distance(cr, &m.xy, &m.yy);                                  \
+    caml_cairo_transform_points(&m, distance,                           \
+                                (double *) Caml_ba_data_val(vsrc),      \
+                                (double *) Caml_ba_data_val(vdst),      \
+                                Caml_ba_array_val(vsrc)->dim[0] / 2);   \
+    return(Val_unit);                                                   \
+  }                                                                     \
+                                                                        \
+  CAMLexport value caml_##name##_distances(value vcr, value vsrc,       \
+                                           value vdst)                  \
+  {                                                                     \
+    /* noalloc */                                                       \
+    cairo_t* cr = CAIRO_VAL(vcr);                                       \
+    cairo_matrix_t m;                                                   \
+    m.xx = 1.;  m.yx = 0.;                                              \
+    name##_distance(cr, &m.xx, &m.yx);                                  \
+    m.xy = 0.;  m.yy = 1.;                                              \
+    name##_distance(cr, &m.xy, &m.yy);                                  \
+    caml_cairo_transform_points(&m, 1,                                  \
+                                (double *) Caml_ba_data_val(vsrc),      \
+                                (double *) Caml_ba_data_val(vdst),      \
+                                Caml_ba_array_val(vsrc)->dim[0] / 2);   \
+    return(Val_unit);                                                   \
+  }
+
+COORD_TRANSFORM_POINTS(cairo_user_to_device, 0)
+COORD_TRANSFORM_POINTS(cairo_device_to_user, 0)
+
 
 /* Font options
 ***********************************************************************/
@@ -1031,6 +1653,65 @@ CAMLexport value caml_cairo_scaled_font_text_to_glyphs
   CAMLreturn(vtriplet);
 }
 
+CAMLexport value caml_cairo_scaled_font_glyph_buffer_extents(value vsf,
+                                                             value vb)
+{
+  CAMLparam2(vsf, vb);
+  CAMLlocal1(vte);
+  struct caml_cairo_glyph_buffer *b = GLYPH_BUFFER_VAL(vb);
+  cairo_text_extents_t te;
+
+  cairo_scaled_font_glyph_extents(SCALED_FONT_VAL(vsf),
+                                  b->glyphs, b->num_glyphs, &te);
+  TEXT_EXTENTS_ASSIGN(vte, te);
+  CAMLreturn(vte);
+}
+
+/* Cairo uses the arrays it is given if they are large enough and
+   allocates new ones otherwise.  The latter must be released with
+   cairo_glyph_free and cairo_text_cluster_free, so their content is
+   copied to the (enlarged) arrays of the buffer. */
+CAMLexport value caml_cairo_scaled_font_text_to_glyph_buffer
+(value vsf, value vx, value vy, value vutf8, value vb)
+{
+  CAMLparam5(vsf, vx, vy, vutf8, vb);
+  struct caml_cairo_glyph_buffer *b = GLYPH_BUFFER_VAL(vb);
+  cairo_glyph_t *glyphs = b->glyphs;
+  int num_glyphs = b->capacity;
+  cairo_text_cluster_t *clusters = b->clusters;
+  int num_clusters = b->clusters_capacity;
+  int new_glyphs, new_clusters;
+  cairo_status_t status;
+
+  status = cairo_scaled_font_text_to_glyphs
+    (SCALED_FONT_VAL(vsf), Double_val(vx), Double_val(vy),
+     String_val(vutf8), caml_string_length(vutf8),
+     &glyphs, &num_glyphs,  &clusters, &num_clusters,  &b->cluster_flags);
+  new_glyphs = (glyphs != b->glyphs);
+  new_clusters = (clusters != b->clusters);
+  if (status == CAIRO_STATUS_SUCCESS
+      && ((new_glyphs && ! caml_cairo_glyph_buffer_reserve(b, num_glyphs))
+          || (new_clusters
+              && ! caml_cairo_glyph_buffer_reserve_clusters(b, num_clusters))))
+    status = CAIRO_STATUS_NO_MEMORY;
+  if (status == CAIRO_STATUS_SUCCESS) {
+    if (new_glyphs)
+      memcpy(b->glyphs, glyphs, num_glyphs * sizeof(cairo_glyph_t));
+    if (new_clusters)
+      memcpy(b->clusters, clusters,
+             num_clusters * sizeof(cairo_text_cluster_t));
+    b->num_glyphs = num_glyphs;
+    b->num_clusters = num_clusters;
+  } else {
+    b->num_glyphs = 0;
+    b->num_clusters = 0;
+  }
+  if (new_glyphs) cairo_glyph_free(glyphs);
+  if (new_clusters) cairo_text_cluster_free(clusters);
+  caml_cairo_raise_Error(status);
+  CAMLreturn(Val_int(num_glyphs));
+}
+
 CAMLexport value caml_cairo_scaled_font_get_font_face(value vsf)
 {
   CAMLparam1(vsf);
@@ -1251,7 +1932,8 @@ CAMLexport value caml_cairo_show_glyphs(value vcr, value vglyphs)
   cairo_glyph_t *glyphs, *p;
 
   ARRAY_GLYPH_VAL(glyphs, p, vglyphs, num_glyphs);
-  cairo_show_glyphs(cr, glyphs, num_glyphs);
+  WITHOUT_RUNTIME_LOCK(cairo_get_target(cr),
+                       cairo_show_glyphs(cr, glyphs, num_glyphs));
   free(glyphs);
   caml_check_status(cr);
   CAMLreturn(Val_unit);
@@ -1295,31 +1977,287 @@ CAMLexport value caml_cairo_glyph_extents(value vcr, value vglyphs)
 }
 
 
+/* Glyph buffers */
 
-/* Toy text API
- ***********************************************************************/
-
-CAMLexport value caml_cairo_select_font_face
-(value vcr, value vslant, value vweight, value vfamily)
+CAMLexport value caml_cairo_glyph_buffer_create(value vsize)
 {
-  CAMLparam4(vcr, vslant, vweight, vfamily);
-  cairo_t *cr = CAIRO_VAL(vcr);
-  cairo_select_font_face(cr, String_val(vfamily),
-                         SLANT_VAL(vslant), WEIGHT_VAL(vweight));
-  caml_check_status(cr);
-  CAMLreturn(Val_unit);
+  CAMLparam1(vsize);
+  CAMLlocal1(vb);
+  struct caml_cairo_glyph_buffer *b;
+
+  /* The custom block is allocated last so that its finalizer never
+     sees an uninitialized pointer. */
+  SET_MALLOC(b, 1, struct caml_cairo_glyph_buffer);
+  b->glyphs = NULL;
+  b->num_glyphs = 0;
+  b->capacity = 0;
+  b->clusters = NULL;
+  b->num_clusters = 0;
+  b->clusters_capacity = 0;
+  b->cluster_flags = 0;
+  if (! caml_cairo_glyph_buffer_reserve(b, Int_val(vsize))) {
+    free(b);
+    caml_raise_out_of_memory();
+  }
+  vb = ALLOC_MEM(glyph_buffer, sizeof(void*),
+                 Int_val(vsize) * sizeof(cairo_glyph_t));
+  GLYPH_BUFFER_VAL(vb) = b;
+  CAMLreturn(vb);
 }
 
-DO1_CONTEXT(cairo_set_font_size, Double_val)
-
-CAMLexport value caml_cairo_set_font_matrix(value vcr, value vmatrix)
+CAMLexport value caml_cairo_glyph_buffer_length(value vb)
 {
-  CAMLparam2(vcr, vmatrix);
-  cairo_t *cr = CAIRO_VAL(vcr);
-  ALLOC_CAIRO_MATRIX(vmatrix);
-  cairo_set_font_matrix(cr, GET_MATRIX(vmatrix));
-  caml_check_status(cr);
-  CAMLreturn(Val_unit);
+  /* noalloc */
+  return(Val_int(GLYPH_BUFFER_VAL(vb)->num_glyphs));
+}
+
+CAMLexport value caml_cairo_glyph_buffer_clear(value vb)
+{
+  /* noalloc */
+  GLYPH_BUFFER_VAL(vb)->num_glyphs = 0;
+  GLYPH_BUFFER_VAL(vb)->num_clusters = 0;
+  return(Val_unit);
+}
+
+CAMLexport value caml_cairo_glyph_buffer_add_unboxed(value vb, intnat index,
+                                                     double x, double y)
+{
+  /* Does not allocate in the OCaml heap but may raise Out_of_memory. */
+  struct caml_cairo_glyph_buffer *b = GLYPH_BUFFER_VAL(vb);
+  cairo_glyph_t *g;
+
+  if (! caml_cairo_glyph_buffer_reserve(b, b->num_glyphs + 1))
+    caml_raise_out_of_memory();
+  g = b->glyphs + b->num_glyphs;
+  g->index = index;
+  g->x = x;
+  g->y = y;
+  b->num_glyphs++;
+  return(Val_unit);
+}
+
+CAMLexport value caml_cairo_glyph_buffer_add(value vb, value vindex,
+                                             value vx, value vy)
+{
+  return caml_cairo_glyph_buffer_add_unboxed(vb, Long_val(vindex),
+                                             Double_val(vx), Double_val(vy));
+}
+
+/* The following functions assume the index [i] was checked. */
+
+CAMLexport value caml_cairo_glyph_buffer_set_unboxed
+(value vb, intnat i, intnat index, double x, double y)
+{
+  /* noalloc */
+  cairo_glyph_t *g = GLYPH_BUFFER_VAL(vb)->glyphs + i;
+  g->index = index;
+  g->x = x;
+  g->y = y;
+  return(Val_unit);
+}
+
+CAMLexport value caml_cairo_glyph_buffer_set(value vb, value vi, value vindex,
+                                             value vx, value vy)
+{
+  return caml_cairo_glyph_buffer_set_unboxed(vb, Long_val(vi),
+                                             Long_val(vindex),
+                                             Double_val(vx), Double_val(vy));
+}
+
+CAMLexport intnat caml_cairo_glyph_buffer_get_index_unboxed(value vb,
+                                                            intnat i)
+{
+  /* noalloc */
+  return(GLYPH_BUFFER_VAL(vb)->glyphs[i].index);
+}
+
+CAMLexport value caml_cairo_glyph_buffer_get_index(value vb, value vi)
+{
+  return(Val_long(GLYPH_BUFFER_VAL(vb)->glyphs[Long_val(vi)].index));
+}
+
+#define GLYPH_BUFFER_GET_COORD(coord)                                   \
+  CAMLexport double caml_cairo_glyph_buffer_get_##coord##_unboxed       \
+  (value vb, intnat i)                                                  \
+  {                                                                     \
+    /* noalloc */                                                       \
+    return(GLYPH_BUFFER_VAL(vb)->glyphs[i].coord);                      \
+  }                                                                     \
+                                                                        \
+  CAMLexport value caml_cairo_glyph_buffer_get_##coord(value vb, value vi) \
+  {                                                                     \
+    return(caml_copy_double                                             \
+           (GLYPH_BUFFER_VAL(vb)->glyphs[Long_val(vi)].coord));         \
+  }
+
+GLYPH_BUFFER_GET_COORD(x)
+GLYPH_BUFFER_GET_COORD(y)
+
+CAMLexport value caml_cairo_glyph_buffer_num_clusters(value vb)
+{
+  /* noalloc */
+  return(Val_int(GLYPH_BUFFER_VAL(vb)->num_clusters));
+}
+
+CAMLexport value caml_cairo_glyph_buffer_backward(value vb)
+{
+  /* noalloc */
+  return(Val_bool(GLYPH_BUFFER_VAL(vb)->cluster_flags
+                  & CAIRO_TEXT_CLUSTER_FLAG_BACKWARD));
+}
+
+/* Assume the index [vi] was checked. */
+CAMLexport value caml_cairo_glyph_buffer_get_cluster_bytes(value vb, value vi)
+{
+  /* noalloc */
+  return(Val_int(GLYPH_BUFFER_VAL(vb)->clusters[Long_val(vi)].num_bytes));
+}
+
+CAMLexport value caml_cairo_glyph_buffer_get_cluster_glyphs(value vb,
+                                                            value vi)
+{
+  /* noalloc */
+  return(Val_int(GLYPH_BUFFER_VAL(vb)->clusters[Long_val(vi)].num_glyphs));
+}
+
+CAMLexport value caml_cairo_glyph_buffer_show_text(value vcr, value vutf8,
+                                                   value vb)
+{
+  CAMLparam3(vcr, vutf8, vb);
+  cairo_t *cr = CAIRO_VAL(vcr);
+  struct caml_cairo_glyph_buffer *b = GLYPH_BUFFER_VAL(vb);
+
+  cairo_show_text_glyphs(cr, String_val(vutf8), caml_string_length(vutf8),
+                         b->glyphs, b->num_glyphs,
+                         b->clusters, b->num_clusters, b->cluster_flags);
+  caml_check_status(cr);
+  CAMLreturn(Val_unit);
+}
+
+/* Same as caml_cairo_glyph_buffer_show_text with the glyphs
+   translated by ([vx], [vy]) (used by Scaled_font.Cache whose runs
+   are positioned relative to the origin).  The runtime lock is
+   released while rendering, so the text, glyphs and clusters are
+   copied beforehand. */
+#define GLYPH_STACK_SIZE 256
+
+CAMLexport value caml_cairo_glyph_buffer_show_text_at
+(value vcr, value vutf8, value vb, value vx, value vy)
+{
+  CAMLparam5(vcr, vutf8, vb, vx, vy);
+  cairo_t *cr = CAIRO_VAL(vcr);
+  struct caml_cairo_glyph_buffer *b = GLYPH_BUFFER_VAL(vb);
+  cairo_glyph_t stack[GLYPH_STACK_SIZE], *glyphs = stack;
+  cairo_text_cluster_t *clusters = NULL;
+  int num_glyphs = b->num_glyphs, num_clusters = b->num_clusters;
+  cairo_text_cluster_flags_t cluster_flags = b->cluster_flags;
+  double x = Double_val(vx), y = Double_val(vy);
+  mlsize_t len = caml_string_length(vutf8);
+  char *utf8;
+  int i;
+
+  utf8 = malloc(len + 1);
+  if (num_glyphs > GLYPH_STACK_SIZE)
+    glyphs = malloc(num_glyphs * sizeof(cairo_glyph_t));
+  if (num_clusters > 0)
+    clusters = malloc(num_clusters * sizeof(cairo_text_cluster_t));
+  if (utf8 == NULL || glyphs == NULL
+      || (num_clusters > 0 && clusters == NULL)) {
+    free(utf8);
+    if (glyphs != stack) free(glyphs);
+    free(clusters);
+    caml_raise_out_of_memory();
+  }
+  memcpy(utf8, String_val(vutf8), len);
+  for(i = 0; i < num_glyphs; i++) {
+    glyphs[i].index = b->glyphs[i].index;
+    glyphs[i].x = b->glyphs[i].x + x;
+    glyphs[i].y = b->glyphs[i].y + y;
+  }
+  if (num_clusters > 0)
+    memcpy(clusters, b->clusters,
+           num_clusters * sizeof(cairo_text_cluster_t));
+  WITHOUT_RUNTIME_LOCK(cairo_get_target(cr),
+                       cairo_show_text_glyphs(cr, utf8, len,
+                                              glyphs, num_glyphs,
+                                              clusters, num_clusters,
+                                              cluster_flags));
+  free(utf8);
+  if (glyphs != stack) free(glyphs);
+  free(clusters);
+  caml_check_status(cr);
+  CAMLreturn(Val_unit);
+}
+
+/* Another thread may modify (thus reallocate) the buffer while the
+   runtime lock is released, so the glyphs are copied beforehand. */
+CAMLexport value caml_cairo_glyph_buffer_show(value vcr, value vb)
+{
+  CAMLparam2(vcr, vb);
+  cairo_t *cr = CAIRO_VAL(vcr);
+  struct caml_cairo_glyph_buffer *b = GLYPH_BUFFER_VAL(vb);
+  cairo_glyph_t stack[GLYPH_STACK_SIZE], *glyphs = stack;
+  int num_glyphs = b->num_glyphs;
+
+  if (num_glyphs > GLYPH_STACK_SIZE)
+    SET_MALLOC(glyphs, num_glyphs, cairo_glyph_t);
+  if (num_glyphs > 0)
+    memcpy(glyphs, b->glyphs, num_glyphs * sizeof(cairo_glyph_t));
+  WITHOUT_RUNTIME_LOCK(cairo_get_target(cr),
+                       cairo_show_glyphs(cr, glyphs, num_glyphs));
+  if (glyphs != stack) free(glyphs);
+  caml_check_status(cr);
+  CAMLreturn(Val_unit);
+}
+
+CAMLexport value caml_cairo_glyph_buffer_path(value vcr, value vb)
+{
+  CAMLparam2(vcr, vb);
+  cairo_t *cr = CAIRO_VAL(vcr);
+  struct caml_cairo_glyph_buffer *b = GLYPH_BUFFER_VAL(vb);
+
+  cairo_glyph_path(cr, b->glyphs, b->num_glyphs);
+  caml_check_status(cr);
+  CAMLreturn(Val_unit);
+}
+
+CAMLexport value caml_cairo_glyph_buffer_extents(value vcr, value vb)
+{
+  CAMLparam2(vcr, vb);
+  CAMLlocal1(vte);
+  struct caml_cairo_glyph_buffer *b = GLYPH_BUFFER_VAL(vb);
+  cairo_text_extents_t te;
+
+  cairo_glyph_extents(CAIRO_VAL(vcr), b->glyphs, b->num_glyphs, &te);
+  TEXT_EXTENTS_ASSIGN(vte, te);
+  CAMLreturn(vte);
+}
+
+
+/* Toy text API
+ ***********************************************************************/
+
+CAMLexport value caml_cairo_select_font_face
+(value vcr, value vslant, value vweight, value vfamily)
+{
+  CAMLparam4(vcr, vslant, vweight, vfamily);
+  cairo_t *cr = CAIRO_VAL(vcr);
+  cairo_select_font_face(cr, String_val(vfamily),
+                         SLANT_VAL(vslant), WEIGHT_VAL(vweight));
+  caml_check_status(cr);
+  CAMLreturn(Val_unit);
+}
+
+DO1_CONTEXT(cairo_set_font_size, Double_val)
+
+CAMLexport value caml_cairo_set_font_matrix(value vcr, value vmatrix)
+{
+  CAMLparam2(vcr, vmatrix);
+  cairo_t *cr = CAIRO_VAL(vcr);
+  ALLOC_CAIRO_MATRIX(vmatrix);
+  cairo_set_font_matrix(cr, GET_MATRIX(vmatrix));
+  caml_check_status(cr);
+  CAMLreturn(Val_unit);
 }
 
 CAMLexport value caml_cairo_get_font_matrix(value vcr)
@@ -1361,6 +2299,72 @@ CAMLexport value caml_cairo_text_extents(value vcr, value vutf8)
 static cairo_user_data_key_t image_bigarray_key;
 /* See the Image surfaces below */
 
+/* Views of a part of an image (tiles and mapped images) hold a
+   reference to the image whose pixels they share. */
+static const cairo_user_data_key_t image_tile_parent_key;
+
+/* Finalize the proxy attached to the image surface.  Cairo may drop
+   the last reference to an image (e.g. a source of a PDF surface)
+   while the runtime lock is released; take it back so the proxy is
+   not released concurrently with a bigarray sharing it, as the GC
+   does it with the lock held (and non-atomically before OCaml 5). */
+static void caml_cairo_image_bigarray_finalize(void *data)
+{
+#define proxy ((struct caml_ba_proxy *) data)
+  CALLBACK_LEAVE_BLOCKING(released);
+  /* Adapted from caml_ba_finalize in the OCaml library sources. */
+  if (PROXY_DECR(proxy) == 0) {
+    if (proxy->size == CAML_CAIRO_POOLED_PROXY)
+      caml_cairo_image_pool_release((struct caml_cairo_pool_proxy *) proxy);
+    else {
+      free(proxy->data);
+      free(proxy);
+    }
+  }
+  CALLBACK_ENTER_BLOCKING(released);
+#undef proxy
+}
+
+/* Make [surf], which uses the pixels of [parent], also hold the
+   bigarray proxy of [parent] (if any) so that the pixels stay alive
+   even if [parent] is finished (which drops its proxy). */
+static cairo_status_t caml_cairo_share_bigarray_proxy(cairo_surface_t *surf,
+                                                      cairo_surface_t *parent)
+{
+  struct caml_ba_proxy *proxy = (struct caml_ba_proxy *)
+    cairo_surface_get_user_data(parent, &image_bigarray_key);
+  cairo_status_t status;
+
+  if (proxy == NULL) return(CAIRO_STATUS_SUCCESS);
+  status = cairo_surface_set_user_data(surf, &image_bigarray_key, proxy,
+                                       caml_cairo_image_bigarray_finalize);
+  if (status == CAIRO_STATUS_SUCCESS) PROXY_INCR(proxy);
+  return(status);
+}
+
+/* Return the proxy of the managed bigarray [b], creating it if needed,
+   with a reference for the caller (to be released with
+   [caml_cairo_image_bigarray_finalize]).  Returns NULL if memory is
+   exhausted. */
+static struct caml_ba_proxy * caml_cairo_bigarray_proxy
+(struct caml_ba_array * b)
+{
+  struct caml_ba_proxy * proxy;
+
+  if (b->proxy != NULL) {
+    PROXY_INCR(b->proxy);
+    return(b->proxy);
+  }
+  /* Adapted from caml_ba_update_proxy in the OCaml std lib. */
+  proxy = malloc(sizeof(struct caml_ba_proxy));
+  if (proxy == NULL) return(NULL);
+  proxy->refcount = 2;      /* original array + caller */
+  proxy->data = b->data;
+  proxy->size = 0; /* CAML_BA_MAPPED_FILE excluded by the callers */
+  b->proxy = proxy;
+  return(proxy);
+}
+
 CAMLexport value caml_cairo_surface_create_similar
 (value vother, value vcontent, value vwidth, value vheight)
 {
@@ -1373,24 +2377,131 @@ CAMLexport value caml_cairo_surface_create_similar
   surf = cairo_surface_create_similar(SURFACE_VAL(vother), content,
                                       Int_val(vwidth), Int_val(vheight));
   caml_cairo_raise_Error(cairo_surface_status(surf));
-  SURFACE_ASSIGN(vsurf, surf);
+  SURFACE_ASSIGN_MEM(vsurf, surf, IMAGE_SURFACE_MEM(surf));
   CAMLreturn(vsurf);
 }
 
+/* A view of a rectangle of [vtarget].  Cairo keeps a reference to the
+   target; the view also shares its bigarray proxy. */
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 10, 0)
+CAMLexport value caml_cairo_surface_create_for_rectangle
+(value vtarget, value vx, value vy, value vw, value vh)
+{
+  CAMLparam5(vtarget, vx, vy, vw, vh);
+  CAMLlocal1(vsurf);
+  cairo_surface_t *target = SURFACE_VAL(vtarget), *surf;
+  cairo_status_t status;
+
+  vsurf = ALLOC(surface);
+  surf = cairo_surface_create_for_rectangle(target, Double_val(vx),
+                                            Double_val(vy), Double_val(vw),
+                                            Double_val(vh));
+  status = cairo_surface_status(surf);
+  if (status == CAIRO_STATUS_SUCCESS)
+    status = caml_cairo_share_bigarray_proxy(surf, target);
+  if (status != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(surf);
+    caml_cairo_raise_Error(status);
+  }
+  SURFACE_VAL(vsurf) = surf;
+  CAMLreturn(vsurf);
+}
+#else
+UNAVAILABLE5(cairo_surface_create_for_rectangle)
+#endif
+
 CAMLexport value caml_cairo_surface_finish(value vsurf)
 {
-  /* noalloc */
+  CAMLparam1(vsurf);
   cairo_surface_t *surface = SURFACE_VAL(vsurf);
 
-  cairo_surface_finish(surface);
+  WITHOUT_RUNTIME_LOCK(surface, cairo_surface_finish(surface));
   /* Remove the user data with the bigarray key.  That will cause the
      finalizer to be executed (and release the proxy) and the
      finalizing function not to be called again when the value is
      garbage collected. */
   cairo_surface_set_user_data(surface, &image_bigarray_key, NULL, NULL);
-  return(Val_unit);
+  CAMLreturn(Val_unit);
+}
+
+CAMLexport value caml_cairo_surface_destroy(value vsurf)
+{
+  CAMLparam1(vsurf);
+  cairo_surface_t *surface = SURFACE_VAL(vsurf);
+  cairo_surface_t *destroyed = caml_cairo_get_surface_destroyed();
+
+  if (surface != destroyed) {
+    SURFACE_VAL(vsurf) = cairo_surface_reference(destroyed);
+    /* The surface itself is only freed when the contexts and patterns
+       using it are. */
+    cairo_surface_destroy(surface);
+  }
+  CAMLreturn(Val_unit);
 }
 
+/* Mapping a surface to an image (Cairo >= 1.12).  The image must be
+   given back to [cairo_surface_unmap_image] (which writes its pixels
+   back to the surface and destroys it), never destroyed directly.
+   Once unmapped, the OCaml value of the image behaves as a destroyed
+   surface, so its finalizer is harmless. */
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 12, 0)
+CAMLexport value caml_cairo_surface_map_to_image(value vsurf, value vextents)
+{
+  CAMLparam2(vsurf, vextents);
+  CAMLlocal1(vimage);
+  cairo_surface_t *surface = SURFACE_VAL(vsurf), *image;
+  cairo_rectangle_int_t r, *extents = NULL;
+  unsigned char *data, *parent;
+
+  if (Is_block(vextents)) {
+    r.x = Int_val(Field(Field(vextents, 0), 0));
+    r.y = Int_val(Field(Field(vextents, 0), 1));
+    r.width = Int_val(Field(Field(vextents, 0), 2));
+    r.height = Int_val(Field(Field(vextents, 0), 3));
+    extents = &r;
+  }
+  vimage = ALLOC(surface);
+  WITHOUT_RUNTIME_LOCK(surface,
+                       image = cairo_surface_map_to_image(surface, extents));
+  /* Error surfaces are static, no need to release them. */
+  caml_cairo_raise_Error(cairo_surface_status(image));
+  SURFACE_VAL(vimage) = image;
+  /* The image of an image surface is a view of its pixels, so the
+     bigarrays of the image must not extend past them (see
+     caml_cairo_image_data_length). */
+  data = cairo_image_surface_get_data(image);
+  parent = cairo_image_surface_get_data(surface);
+  if (parent != NULL && data >= parent
+      && data < parent + cairo_image_surface_get_stride(surface)
+                         * cairo_image_surface_get_height(surface)
+      && cairo_surface_set_user_data(image, &image_tile_parent_key,
+                                     cairo_surface_reference(surface),
+                                     (cairo_destroy_func_t)
+                                     cairo_surface_destroy)
+         != CAIRO_STATUS_SUCCESS)
+    cairo_surface_destroy(surface); /* unprotected view, not fatal */
+  CAMLreturn(vimage);
+}
+
+CAMLexport value caml_cairo_surface_unmap_image(value vsurf, value vimage)
+{
+  CAMLparam2(vsurf, vimage);
+  cairo_surface_t *surface = SURFACE_VAL(vsurf);
+  cairo_surface_t *image = SURFACE_VAL(vimage);
+  cairo_surface_t *destroyed = caml_cairo_get_surface_destroyed();
+
+  if (image != destroyed) {
+    SURFACE_VAL(vimage) = cairo_surface_reference(destroyed);
+    WITHOUT_RUNTIME_LOCK(surface, cairo_surface_unmap_image(surface, image));
+    caml_cairo_raise_Error(cairo_surface_status(surface));
+  }
+  CAMLreturn(Val_unit);
+}
+#else
+UNAVAILABLE2(cairo_surface_map_to_image)
+UNAVAILABLE2(cairo_surface_unmap_image)
+#endif
+
 DO_SURFACE(cairo_surface_flush)
 
 CAMLexport value caml_cairo_surface_get_font_options(value vsurf)
@@ -1456,13 +2567,35 @@ GET_SURFACE_XY(cairo_surface_get_fallback_resolution)
 
 CAMLexport value caml_cairo_surface_get_type(value vsurf)
 {
-  /* noalloc */
+  /* May raise [Failure] for types added by future versions of Cairo. */
   cairo_surface_type_t k = cairo_surface_get_type(SURFACE_VAL(vsurf));
   return(VAL_SURFACE_KIND(k));
 }
 
-DO_SURFACE(cairo_surface_copy_page)
-DO_SURFACE(cairo_surface_show_page)
+CAMLexport value caml_cairo_surface_is_image(value vsurf)
+{
+  /* noalloc */
+  return(Val_bool(cairo_surface_get_type(SURFACE_VAL(vsurf))
+                  == CAIRO_SURFACE_TYPE_IMAGE));
+}
+
+CAMLexport value caml_cairo_surface_copy_page(value vsurf)
+{
+  CAMLparam1(vsurf);
+  cairo_surface_t *surface = SURFACE_VAL(vsurf);
+  WITHOUT_RUNTIME_LOCK(surface, cairo_surface_copy_page(surface));
+  caml_cairo_raise_Error(cairo_surface_status(surface));
+  CAMLreturn(Val_unit);
+}
+
+CAMLexport value caml_cairo_surface_show_page(value vsurf)
+{
+  CAMLparam1(vsurf);
+  cairo_surface_t *surface = SURFACE_VAL(vsurf);
+  WITHOUT_RUNTIME_LOCK(surface, cairo_surface_show_page(surface));
+  caml_cairo_raise_Error(cairo_surface_status(surface));
+  CAMLreturn(Val_unit);
+}
 
 CAMLexport value caml_cairo_surface_has_show_text_glyphs(value vsurf)
 {
@@ -1471,6 +2604,123 @@ CAMLexport value caml_cairo_surface_has_show_text_glyphs(value vsurf)
   return(Val_bool(b));
 }
 
+/* MIME data (Cairo >= 1.10).  Cairo holds on to the data until it is
+   replaced or the surface is destroyed.  Strings may be moved by the
+   GC, so they are copied.  Managed bigarrays are shared: Cairo keeps
+   a reference to their proxy, released by
+   caml_cairo_image_bigarray_finalize which takes the runtime lock
+   back if needed (the surface may be destroyed while it is
+   released). */
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 10, 0)
+
+static void caml_cairo_set_mime_data
+(cairo_surface_t *surface, const char *mime_type, unsigned char *data,
+ unsigned long length, cairo_destroy_func_t destroy, void *closure)
+{
+  cairo_status_t status;
+
+  status = cairo_surface_set_mime_data(surface, mime_type, data, length,
+                                       destroy, closure);
+  if (status != CAIRO_STATUS_SUCCESS) {
+    /* Cairo did not take ownership of the data. */
+    destroy(closure);
+    caml_cairo_raise_Error(status);
+  }
+}
+
+static unsigned char * caml_cairo_copy_mime_data(const void *src,
+                                                 unsigned long length)
+{
+  /* Add 1 to never request 0 bytes. */
+  unsigned char *data = malloc(length + 1);
+  if (data == NULL) caml_raise_out_of_memory();
+  memcpy(data, src, length);
+  return(data);
+}
+
+CAMLexport value caml_cairo_surface_set_mime_data
+(value vsurf, value vmime, value vdata)
+{
+  CAMLparam3(vsurf, vmime, vdata);
+  unsigned long length = caml_string_length(vdata);
+  unsigned char *data = caml_cairo_copy_mime_data(String_val(vdata), length);
+
+  caml_cairo_set_mime_data(SURFACE_VAL(vsurf), String_val(vmime),
+                           data, length, &free, data);
+  CAMLreturn(Val_unit);
+}
+
+#define b (Caml_ba_array_val(vb))
+CAMLexport value caml_cairo_surface_set_mime_data_bigarray
+(value vsurf, value vmime, value vb)
+{
+  CAMLparam3(vsurf, vmime, vb);
+  unsigned long length = b->dim[0];
+  struct caml_ba_proxy *proxy;
+  unsigned char *data;
+
+  if ((b->flags & CAML_BA_MANAGED_MASK) == CAML_BA_MANAGED) {
+    proxy = caml_cairo_bigarray_proxy(b);
+    if (proxy == NULL) caml_raise_out_of_memory();
+    caml_cairo_set_mime_data(SURFACE_VAL(vsurf), String_val(vmime),
+                             (unsigned char *) b->data, length,
+                             &caml_cairo_image_bigarray_finalize, proxy);
+  }
+  else {
+    /* The lifetime of external data and memory mapped files is not
+       known, copy them. */
+    data = caml_cairo_copy_mime_data(b->data, length);
+    caml_cairo_set_mime_data(SURFACE_VAL(vsurf), String_val(vmime),
+                             data, length, &free, data);
+  }
+  CAMLreturn(Val_unit);
+}
+#undef b
+
+CAMLexport value caml_cairo_surface_remove_mime_data(value vsurf, value vmime)
+{
+  CAMLparam2(vsurf, vmime);
+  caml_cairo_raise_Error(
+    cairo_surface_set_mime_data(SURFACE_VAL(vsurf), String_val(vmime),
+                                NULL, 0, NULL, NULL));
+  CAMLreturn(Val_unit);
+}
+
+CAMLexport value caml_cairo_surface_get_mime_data(value vsurf, value vmime)
+{
+  CAMLparam2(vsurf, vmime);
+  CAMLlocal2(vs, vsome);
+  const unsigned char *data;
+  unsigned long length;
+
+  cairo_surface_get_mime_data(SURFACE_VAL(vsurf), String_val(vmime),
+                              &data, &length);
+  if (data == NULL) CAMLreturn(Val_int(0)); /* None */
+  vs = caml_alloc_string(length);
+  memcpy((char *) String_val(vs), data, length);
+  vsome = caml_alloc_tuple(1);
+  Store_field(vsome, 0, vs);
+  CAMLreturn(vsome);
+}
+#else
+UNAVAILABLE3(cairo_surface_set_mime_data)
+UNAVAILABLE3(cairo_surface_set_mime_data_bigarray)
+UNAVAILABLE2(cairo_surface_remove_mime_data)
+UNAVAILABLE2(cairo_surface_get_mime_data)
+#endif
+
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 12, 0)
+CAMLexport value caml_cairo_surface_supports_mime_type(value vsurf,
+                                                       value vmime)
+{
+  cairo_bool_t b = cairo_surface_supports_mime_type(SURFACE_VAL(vsurf),
+                                                    String_val(vmime));
+  return(Val_bool(b));
+}
+#else
+UNAVAILABLE2(cairo_surface_supports_mime_type)
+#endif
+
 
 /* Image surfaces
 ***********************************************************************/
@@ -1487,18 +2737,6 @@ CAMLexport value caml_cairo_surface_has_show_text_glyphs(value vsurf)
    it will hold a bigarray proxy that will be referenced by all
    bigarrays and surfaces created from them (and ref count the data).  */
 
-/* Finalize the proxy attached to the image surface. */
-static void caml_cairo_image_bigarray_finalize(void *data)
-{
-#define proxy ((struct caml_ba_proxy *) data)
-  /* Adapted from caml_ba_finalize in the OCaml library sources. */
-  if (-- proxy->refcount == 0) {
-    free(proxy->data);
-    free(proxy);
-  }
-#undef proxy
-}
-
 CAMLexport value caml_cairo_image_surface_create(value vformat,
                                                  value vwidth, value vheight)
 {
@@ -1511,39 +2749,171 @@ CAMLexport value caml_cairo_image_surface_create(value vformat,
   struct caml_ba_proxy *proxy;
   cairo_status_t status;
 
-  vsurf = ALLOC(surface); /* alloc this first in case it raises an exn */
-  /* Use calloc to initialize the surface to all black. */
-  data = calloc(1, stride * Int_val(vheight));
-  if (data == NULL) caml_raise_out_of_memory();
-  surf = cairo_image_surface_create_for_data(data, format, Int_val(vwidth),
+  /* alloc this first in case it raises an exn */
+  vsurf = ALLOC_MEM(surface, sizeof(void*),
+                    (mlsize_t) stride * Int_val(vheight));
+  /* Use calloc to initialize the surface to all black. */
+  data = calloc(1, stride * Int_val(vheight));
+  if (data == NULL) caml_raise_out_of_memory();
+  surf = cairo_image_surface_create_for_data(data, format, Int_val(vwidth),
+                                             Int_val(vheight), stride);
+  status = cairo_surface_status(surf);
+  if (status != CAIRO_STATUS_SUCCESS) {
+    free(data);
+    caml_cairo_raise_Error(status);
+  }
+  /* Create a proxy and attach it to the surface */
+  proxy = malloc(sizeof(struct caml_ba_proxy));
+  if (proxy == NULL) {
+    cairo_surface_destroy(surf);
+    free(data);
+    caml_cairo_raise_Error(CAIRO_STATUS_NO_MEMORY);
+  }
+  proxy->refcount = 1;      /* surface */
+  proxy->data = data;
+  proxy->size = 0;
+  status = cairo_surface_set_user_data(surf, &image_bigarray_key, proxy,
+                                       caml_cairo_image_bigarray_finalize);
+  if (status != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(surf);
+    free(data);
+    free(proxy);
+    caml_cairo_raise_Error(status);
+  }
+  SURFACE_VAL(vsurf) = surf;
+  CAMLreturn(vsurf);
+}
+
+/* Image pools (see Image.Pool.t in cairo_ocaml_types.h). */
+
+CAMLexport value caml_cairo_image_pool_create(value vmax_bytes)
+{
+  CAMLparam1(vmax_bytes);
+  CAMLlocal1(vpool);
+  struct caml_cairo_image_pool *pool;
+
+  pool = malloc(sizeof(struct caml_cairo_image_pool));
+  if (pool == NULL) caml_raise_out_of_memory();
+  pool->lock = 0;
+  pool->closed = 0;
+  pool->lent = 0;
+  pool->max_bytes = Long_val(vmax_bytes);
+  pool->idle_bytes = 0;
+  pool->hits = 0;
+  pool->misses = 0;
+  pool->idle = NULL;
+  vpool = ALLOC(image_pool);
+  IMAGE_POOL_VAL(vpool) = pool;
+  CAMLreturn(vpool);
+}
+
+/* Return a buffer of [bytes] bytes lent by [pool], with a reference
+   for the caller, or NULL if memory is exhausted. */
+static struct caml_cairo_pool_proxy * caml_cairo_image_pool_take
+(struct caml_cairo_image_pool *pool, size_t bytes, int zeroed)
+{
+  struct caml_cairo_pool_proxy *p, **prev;
+
+  POOL_LOCK(pool);
+  for(prev = &pool->idle; *prev != NULL; prev = &(*prev)->next) {
+    if ((*prev)->bytes == bytes) break;
+  }
+  p = *prev;
+  if (p != NULL) {
+    *prev = p->next;
+    pool->idle_bytes -= bytes;
+    pool->hits++;
+    pool->lent++;
+  }
+  else pool->misses++;
+  POOL_UNLOCK(pool);
+  if (p != NULL) {
+    if (zeroed) memset(p->proxy.data, 0, bytes);
+  }
+  else {
+    p = malloc(sizeof(struct caml_cairo_pool_proxy));
+    if (p == NULL) return(NULL);
+    /* Never request 0 bytes. */
+    p->proxy.data = zeroed ? calloc(1, bytes + 1) : malloc(bytes + 1);
+    if (p->proxy.data == NULL) {
+      free(p);
+      return(NULL);
+    }
+    p->proxy.size = CAML_CAIRO_POOLED_PROXY;
+    p->pool = pool;
+    p->bytes = bytes;
+    POOL_LOCK(pool);
+    pool->lent++;
+    POOL_UNLOCK(pool);
+  }
+  p->proxy.refcount = 1;
+  return(p);
+}
+
+CAMLexport value caml_cairo_image_pool_surface_create
+(value vpool, value vzeroed, value vformat, value vwidth, value vheight)
+{
+  CAMLparam5(vpool, vzeroed, vformat, vwidth, vheight);
+  CAMLlocal1(vsurf);
+  cairo_format_t format = FORMAT_VAL(vformat);
+  int stride = cairo_format_stride_for_width(format, Int_val(vwidth));
+  size_t bytes = (size_t) stride * Int_val(vheight);
+  struct caml_cairo_pool_proxy *p;
+  cairo_surface_t *surf;
+  cairo_status_t status;
+
+  /* As cairo_image_surface_create (the stride is -1 for invalid
+     widths). */
+  if (stride < 0 || Int_val(vheight) < 0)
+    caml_cairo_raise_Error(CAIRO_STATUS_INVALID_SIZE);
+  /* alloc this first in case it raises an exn */
+  vsurf = ALLOC_MEM(surface, sizeof(void*), (mlsize_t) bytes);
+  p = caml_cairo_image_pool_take(IMAGE_POOL_VAL(vpool), bytes,
+                                 Bool_val(vzeroed));
+  if (p == NULL) caml_raise_out_of_memory();
+  surf = cairo_image_surface_create_for_data(p->proxy.data, format,
+                                             Int_val(vwidth),
                                              Int_val(vheight), stride);
   status = cairo_surface_status(surf);
-  if (status != CAIRO_STATUS_SUCCESS) {
-    free(data);
-    caml_cairo_raise_Error(status);
-  }
-  /* Create a proxy and attach it to the surface */
-  proxy = malloc(sizeof(struct caml_ba_proxy));
-  if (proxy == NULL) {
-    cairo_surface_destroy(surf);
-    free(data);
-    caml_cairo_raise_Error(CAIRO_STATUS_NO_MEMORY);
+  if (status == CAIRO_STATUS_SUCCESS) {
+    status = cairo_surface_set_user_data(surf, &image_bigarray_key, p,
+                                         caml_cairo_image_bigarray_finalize);
+    if (status != CAIRO_STATUS_SUCCESS) cairo_surface_destroy(surf);
   }
-  proxy->refcount = 1;      /* surface */
-  proxy->data = data;
-  proxy->size = 0;
-  status = cairo_surface_set_user_data(surf, &image_bigarray_key, proxy,
-                                       caml_cairo_image_bigarray_finalize);
   if (status != CAIRO_STATUS_SUCCESS) {
-    cairo_surface_destroy(surf);
-    free(data);
-    free(proxy);
+    caml_cairo_image_bigarray_finalize(p);
     caml_cairo_raise_Error(status);
   }
   SURFACE_VAL(vsurf) = surf;
   CAMLreturn(vsurf);
 }
 
+CAMLexport value caml_cairo_image_pool_clear(value vpool)
+{
+  /* noalloc */
+  caml_cairo_image_pool_free_idle(IMAGE_POOL_VAL(vpool));
+  return(Val_unit);
+}
+
+CAMLexport value caml_cairo_image_pool_stats(value vpool)
+{
+  CAMLparam1(vpool);
+  CAMLlocal1(vstats);
+  struct caml_cairo_image_pool *pool = IMAGE_POOL_VAL(vpool);
+  intnat idle_bytes, hits, misses;
+
+  POOL_LOCK(pool);
+  idle_bytes = pool->idle_bytes;
+  hits = pool->hits;
+  misses = pool->misses;
+  POOL_UNLOCK(pool);
+  vstats = caml_alloc_tuple(3);
+  Store_field(vstats, 0, Val_long(idle_bytes));
+  Store_field(vstats, 1, Val_long(hits));
+  Store_field(vstats, 2, Val_long(misses));
+  CAMLreturn(vstats);
+}
+
 CAMLexport value caml_cairo_format_stride_for_width(value vformat, value vw)
 {
   /* noalloc */
@@ -1562,22 +2932,9 @@ static cairo_status_t caml_cairo_image_bigarray_attach_proxy
 
   if ((b->flags & CAML_BA_MANAGED_MASK) == CAML_BA_EXTERNAL)
     return(CAIRO_STATUS_SUCCESS);
-  if (b->proxy != NULL) {
-    /* If b is already a proxy, increment refcount. */
-    /* FIXME, use caml_atomic_refcount_incr if available. */
-    ++ b->proxy->refcount;
-  }
-  else {
-    /* Otherwise, create proxy and attach it to b and the surface.
-       (Adapted from caml_ba_update_proxy in the OCaml std lib.) */
-    proxy = malloc(sizeof(struct caml_ba_proxy));
-    if (proxy == NULL) return(CAIRO_STATUS_NO_MEMORY);
-    proxy->refcount = 2;      /* original array + surface */
-    proxy->data = b->data;
-    proxy->size = 0; /* CAML_BA_MAPPED_FILE excluded by the calling fun */
-    b->proxy = proxy;
-  }
-  return cairo_surface_set_user_data(surf, &image_bigarray_key, b->proxy,
+  proxy = caml_cairo_bigarray_proxy(b);
+  if (proxy == NULL) return(CAIRO_STATUS_NO_MEMORY);
+  return cairo_surface_set_user_data(surf, &image_bigarray_key, proxy,
                                      caml_cairo_image_bigarray_finalize);
 }
 
@@ -1613,7 +2970,27 @@ SURFACE_CREATE_DATA(data8)
 SURFACE_CREATE_DATA(data32)
 #undef b
 
-#define SURFACE_GET_DATA(type, num_dims, dims ...)                      \
+/* Number of bytes of the pixels of the image [surf] accessible from
+   its data: [stride * height] except for views of a part of an image,
+   whose last row may end before the next [stride] bytes. */
+static intnat caml_cairo_image_data_length(cairo_surface_t *surf)
+{
+  cairo_surface_t *parent = (cairo_surface_t *)
+    cairo_surface_get_user_data(surf, &image_tile_parent_key);
+  intnat len = (intnat) cairo_image_surface_get_stride(surf)
+    * cairo_image_surface_get_height(surf);
+  intnat avail;
+
+  if (parent != NULL) {
+    avail = cairo_image_surface_get_data(parent)
+      + caml_cairo_image_data_length(parent)
+      - cairo_image_surface_get_data(surf);
+    if (avail < len) len = avail;
+  }
+  return(len);
+}
+
+#define SURFACE_GET_DATA(type, check, num_dims, dims ...)               \
   CAMLexport value caml_cairo_image_surface_get_##type(value vsurf)     \
   {                                                                     \
     CAMLparam1(vsurf);                                                  \
@@ -1625,6 +3002,7 @@ SURFACE_CREATE_DATA(data32)
                                                                         \
     if (data == NULL)                                                   \
       caml_invalid_argument("Cairo.Image.get_data: not an image surface.");  \
+    check;                                                              \
     if (proxy == NULL) {                                                \
       /* We assume the payload is externally managed */                \
       vb = caml_ba_alloc(CAML_BA_##type | CAML_BA_C_LAYOUT              \
@@ -1634,20 +3012,98 @@ SURFACE_CREATE_DATA(data32)
       vb = caml_ba_alloc(CAML_BA_##type | CAML_BA_C_LAYOUT              \
                          | CAML_BA_MANAGED,                             \
                          num_dims, data, dim);                          \
+      if (proxy->size == CAML_CAIRO_POOLED_PROXY)                       \
+        caml_cairo_pool_proxy_detach(proxy);                            \
       /* Attach the proxy of the surface to the bigarray */             \
-      ++ proxy->refcount;                                               \
+      PROXY_INCR(proxy);                                                \
       (Caml_ba_array_val(vb))->proxy = proxy;                           \
     }                                                                   \
     CAMLreturn(vb);                                                     \
   }
 
-SURFACE_GET_DATA(UINT8, 1,
-                 cairo_image_surface_get_stride(SURFACE_VAL(vsurf))
-                 * cairo_image_surface_get_height(SURFACE_VAL(vsurf)) )
-SURFACE_GET_DATA(INT32, 2,
+SURFACE_GET_DATA(UINT8, ,
+                 1, caml_cairo_image_data_length(SURFACE_VAL(vsurf)))
+/* The rows of the 2D array all have [stride] bytes, so the last one of
+   a view may extend past the pixels of its parent. */
+SURFACE_GET_DATA(INT32,
+                 if (caml_cairo_image_data_length(SURFACE_VAL(vsurf))
+                     < dim[0] * dim[1] * 4)
+                   caml_invalid_argument("Cairo.Image.get_data32: the last "
+                                         "row of this view extends past "
+                                         "the image it is part of"),
+                 2,
                  cairo_image_surface_get_height(SURFACE_VAL(vsurf)),
                  cairo_image_surface_get_stride(SURFACE_VAL(vsurf)) / 4 )
 
+/* Make the bigarray [vb], viewing pixels that are about to be
+   released, empty so that (safe) accesses to it fail. */
+CAMLexport value caml_cairo_image_data_invalidate(value vb)
+{
+  /* noalloc */
+  struct caml_ba_array *b = Caml_ba_array_val(vb);
+  int i;
+  for (i = 0; i < b->num_dims; i++) b->dim[i] = 0;
+  return(Val_unit);
+}
+
+
+/* A tile is an image surface sharing the pixels of the rectangle
+   ([x], [y], [w], [h]) of the image surface [vsurf].  It holds a
+   reference to the latter so the pixels stay alive.  The device
+   offset is set so that user coordinates are the ones of [vsurf]. */
+CAMLexport value caml_cairo_image_surface_create_for_tile
+(value vsurf, value vx, value vy, value vw, value vh)
+{
+  CAMLparam5(vsurf, vx, vy, vw, vh);
+  CAMLlocal1(vtile);
+  cairo_surface_t *surf = SURFACE_VAL(vsurf), *tile;
+  unsigned char *data = cairo_image_surface_get_data(surf);
+  cairo_format_t format = cairo_image_surface_get_format(surf);
+  int stride = cairo_image_surface_get_stride(surf);
+  int x = Int_val(vx), y = Int_val(vy), w = Int_val(vw), h = Int_val(vh);
+  int bpp;
+  cairo_status_t status;
+
+  if (data == NULL)
+    caml_invalid_argument("Cairo.Tiled: not an image surface");
+  switch (format) {
+  case CAIRO_FORMAT_ARGB32:
+  case CAIRO_FORMAT_RGB24: bpp = 32;  break;
+  case CAIRO_FORMAT_A8: bpp = 8;  break;
+  case CAIRO_FORMAT_A1: bpp = 1;  break;
+  default:
+    caml_invalid_argument("Cairo.Tiled: unsupported image format");
+  }
+  if (x < 0 || y < 0 || w <= 0 || h <= 0
+      || x + w > cairo_image_surface_get_width(surf)
+      || y + h > cairo_image_surface_get_height(surf))
+    caml_invalid_argument("Cairo.Tiled: tile outside the image");
+  /* Pixman wants the rows of the tile to be 32 bits aligned. */
+  if ((x * bpp) % 32 != 0)
+    caml_invalid_argument("Cairo.Tiled: unaligned tile");
+  vtile = ALLOC(surface);
+  tile = cairo_image_surface_create_for_data(data + y * stride + x * bpp / 8,
+                                             format, w, h, stride);
+  caml_cairo_raise_Error(cairo_surface_status(tile));
+  status = cairo_surface_set_user_data(tile, &image_tile_parent_key,
+                                       cairo_surface_reference(surf),
+                                       (cairo_destroy_func_t)
+                                       cairo_surface_destroy);
+  if (status != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(surf);
+    cairo_surface_destroy(tile);
+    caml_cairo_raise_Error(status);
+  }
+  status = caml_cairo_share_bigarray_proxy(tile, surf);
+  if (status != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(tile);
+    caml_cairo_raise_Error(status);
+  }
+  cairo_surface_set_device_offset(tile, -x, -y);
+  SURFACE_VAL(vtile) = tile;
+  CAMLreturn(vtile);
+}
+
 
 #define GET_SURFACE(name, val_of, type)                         \
   CAMLexport value caml_##name(value vsurf)                     \
@@ -1664,18 +3120,294 @@ GET_SURFACE(cairo_image_surface_get_width, Val_int, int)
 GET_SURFACE(cairo_image_surface_get_height, Val_int, int)
 GET_SURFACE(cairo_image_surface_get_stride, Val_int, int)
 
+
+/* Convert the row [vi] of the ARGB32 or RGB24 data [vdata] to the
+   [Image.output_format] [vfmt] into [vbuf] (whose length gives the
+   number of pixels).  The loops are kept simple so the compiler can
+   vectorize them. */
+CAMLexport value caml_cairo_image_export_row(value vdata, value vi,
+                                             value vfmt, value vopaque,
+                                             value vbuf)
+{
+  /* noalloc */
+  struct caml_ba_array *b = Caml_ba_array_val(vdata);
+  const uint32_t *src = (uint32_t *) b->data + Long_val(vi) * b->dim[1];
+  unsigned char *dst = (unsigned char *) String_val(vbuf);
+  const uint32_t alpha = Bool_val(vopaque) ? 0xFF000000 : 0;
+  intnat j, w;
+  uint32_t p, a;
+
+  switch (Int_val(vfmt)) {
+  case 0: /* PPM */
+    w = caml_string_length(vbuf) / 3;
+    for(j = 0; j < w; j++) {
+      p = src[j];
+      dst[3 * j] = p >> 16;
+      dst[3 * j + 1] = p >> 8;
+      dst[3 * j + 2] = p;
+    }
+    break;
+  case 1: /* PAM, not premultiplied */
+    w = caml_string_length(vbuf) / 4;
+    for(j = 0; j < w; j++) {
+      p = src[j] | alpha;
+      a = p >> 24;
+      if (a == 0) {
+        dst[4 * j] = dst[4 * j + 1] = dst[4 * j + 2] = dst[4 * j + 3] = 0;
+      }
+      else {
+        dst[4 * j] = (((p >> 16) & 0xFF) * 255 + a / 2) / a;
+        dst[4 * j + 1] = (((p >> 8) & 0xFF) * 255 + a / 2) / a;
+        dst[4 * j + 2] = ((p & 0xFF) * 255 + a / 2) / a;
+        dst[4 * j + 3] = a;
+      }
+    }
+    break;
+  case 2: /* RGBA */
+    w = caml_string_length(vbuf) / 4;
+    for(j = 0; j < w; j++) {
+      p = src[j] | alpha;
+      dst[4 * j] = p >> 16;
+      dst[4 * j + 1] = p >> 8;
+      dst[4 * j + 2] = p;
+      dst[4 * j + 3] = p >> 24;
+    }
+    break;
+  default: /* BGRA */
+    w = caml_string_length(vbuf) / 4;
+    for(j = 0; j < w; j++) {
+      p = src[j] | alpha;
+      dst[4 * j] = p;
+      dst[4 * j + 1] = p >> 8;
+      dst[4 * j + 2] = p >> 16;
+      dst[4 * j + 3] = p >> 24;
+    }
+  }
+  return(Val_unit);
+}
+
+/* Pixel conversion kernels.  The arguments were checked on the OCaml
+   side (the surfaces are flushed image surfaces of the right format
+   and sizes, the bigarrays are large enough).  As above, the loops
+   are kept simple so the compiler can vectorize them. */
+
+/* Multiply [c] by [a]/255, rounding to the nearest. */
+#define MUL_UN8(c, a, t) \
+  ((t) = (c) * (a) + 0x80, ((t) + ((t) >> 8)) >> 8)
+
+static void caml_cairo_premultiply(uint32_t *p, intnat n)
+{
+  intnat j;
+  uint32_t a, t1, t2, t3;
+  for(j = 0; j < n; j++) {
+    a = p[j] >> 24;
+    p[j] = (a << 24) | (MUL_UN8((p[j] >> 16) & 0xFF, a, t1) << 16)
+      | (MUL_UN8((p[j] >> 8) & 0xFF, a, t2) << 8)
+      | MUL_UN8(p[j] & 0xFF, a, t3);
+  }
+}
+
+static void caml_cairo_unpremultiply(uint32_t *p, intnat n)
+{
+  intnat j;
+  uint32_t a, r, g, b;
+  for(j = 0; j < n; j++) {
+    a = p[j] >> 24;
+    if (a != 0 && a != 0xFF) {
+      r = (((p[j] >> 16) & 0xFF) * 255 + a / 2) / a;
+      g = (((p[j] >> 8) & 0xFF) * 255 + a / 2) / a;
+      b = ((p[j] & 0xFF) * 255 + a / 2) / a;
+      /* Invalid pixels (a colour channel above the alpha) would
+         overflow into the neighbouring channel. */
+      if (r > 0xFF) r = 0xFF;
+      if (g > 0xFF) g = 0xFF;
+      if (b > 0xFF) b = 0xFF;
+      p[j] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+  }
+}
+
+CAMLexport value caml_cairo_image_premultiply(value vdata)
+{
+  /* noalloc */
+  struct caml_ba_array *b = Caml_ba_array_val(vdata);
+  caml_cairo_premultiply((uint32_t *) b->data, b->dim[0] * b->dim[1]);
+  return(Val_unit);
+}
+
+CAMLexport value caml_cairo_image_unpremultiply(value vdata)
+{
+  /* noalloc */
+  struct caml_ba_array *b = Caml_ba_array_val(vdata);
+  caml_cairo_unpremultiply((uint32_t *) b->data, b->dim[0] * b->dim[1]);
+  return(Val_unit);
+}
+
+/* Whether [convert] handles the pixels of the format [f]. */
+#define CONVERTIBLE_FORMAT(f) \
+  ((f) == CAIRO_FORMAT_ARGB32 || (f) == CAIRO_FORMAT_RGB24 \
+   || (f) == CAIRO_FORMAT_A8 || (f) == CAIRO_FORMAT_A1)
+
+/* Copy the pixels of the image [vsrc] to the image [vdst] (of the
+   same size), converting between ARGB32, RGB24 and A8.  The formats
+   are checked here because [Image.get_format] cannot represent the
+   formats added by later versions of Cairo. */
+CAMLexport value caml_cairo_image_convert(value vsrc, value vdst)
+{
+  cairo_surface_t *src = SURFACE_VAL(vsrc), *dst = SURFACE_VAL(vdst);
+  cairo_format_t sfmt = cairo_image_surface_get_format(src);
+  cairo_format_t dfmt = cairo_image_surface_get_format(dst);
+  const int w = cairo_image_surface_get_width(src);
+  const int h = cairo_image_surface_get_height(src);
+  const int sstride = cairo_image_surface_get_stride(src);
+  const int dstride = cairo_image_surface_get_stride(dst);
+  const unsigned char *s = cairo_image_surface_get_data(src);
+  unsigned char *d = cairo_image_surface_get_data(dst);
+  const uint32_t *s32;
+  uint32_t *d32;
+  const uint32_t alpha = (sfmt == CAIRO_FORMAT_RGB24) ? 0xFF000000 : 0;
+  int i, j;
+
+  if (! CONVERTIBLE_FORMAT(sfmt) || ! CONVERTIBLE_FORMAT(dfmt))
+    caml_invalid_argument("Cairo.Image.convert: unsupported image format");
+  if ((sfmt == CAIRO_FORMAT_A1 || dfmt == CAIRO_FORMAT_A1) && sfmt != dfmt)
+    caml_invalid_argument("Cairo.Image.convert: A1 can only be copied "
+                          "to A1");
+  for(i = 0; i < h; i++, s += sstride, d += dstride) {
+    s32 = (const uint32_t *) s;
+    d32 = (uint32_t *) d;
+    if (sfmt == dfmt) {
+      memcpy(d, s, sfmt == CAIRO_FORMAT_A8 ? w :
+             sfmt == CAIRO_FORMAT_A1 ? (w + 7) / 8 : 4 * w);
+    }
+    else if (sfmt == CAIRO_FORMAT_A8) {
+      /* Black with the given alpha. */
+      for(j = 0; j < w; j++) d32[j] = (uint32_t) s[j] << 24;
+    }
+    else if (dfmt == CAIRO_FORMAT_A8) {
+      for(j = 0; j < w; j++) d[j] = (s32[j] | alpha) >> 24;
+    }
+    else {
+      /* ARGB32 <-> RGB24.  The colours are premultiplied, so dropping
+         the alpha amounts to compositing over black. */
+      for(j = 0; j < w; j++) d32[j] = s32[j] | alpha;
+    }
+  }
+  return(Val_unit);
+}
+
+/* Byte offsets of the red, green, blue and alpha channels for the
+   OCaml channel orders [`RGBA | `BGRA | `ARGB | `ABGR]. */
+static const int caml_cairo_channel_offsets[4][4] = {
+  {0, 1, 2, 3}, {2, 1, 0, 3}, {1, 2, 3, 0}, {3, 2, 1, 0} };
+
+/* Write the pixels of the ARGB32 or RGB24 image [vsurf] to [vb], 4
+   bytes per pixel in the channel order [vorder], rows being [vstride]
+   bytes apart.  Alpha is straight unless [vpremul] is true. */
+CAMLexport value caml_cairo_image_to_data8(value vsurf, value vorder,
+                                           value vpremul, value vstride,
+                                           value vb)
+{
+  /* noalloc */
+  cairo_surface_t *surf = SURFACE_VAL(vsurf);
+  const int w = cairo_image_surface_get_width(surf);
+  const int h = cairo_image_surface_get_height(surf);
+  const int stride = cairo_image_surface_get_stride(surf);
+  const unsigned char *s = cairo_image_surface_get_data(surf);
+  unsigned char *d = Caml_ba_data_val(vb);
+  const intnat dstride = Long_val(vstride);
+  const int *off = caml_cairo_channel_offsets[Int_val(vorder)];
+  const int ir = off[0], ig = off[1], ib = off[2], ia = off[3];
+  const uint32_t alpha =
+    (cairo_image_surface_get_format(surf) == CAIRO_FORMAT_RGB24) ?
+    0xFF000000 : 0;
+  const int premul = Bool_val(vpremul);
+  const uint32_t *s32;
+  uint32_t p, a;
+  int i, j;
+
+  for(i = 0; i < h; i++, s += stride, d += dstride) {
+    s32 = (const uint32_t *) s;
+    for(j = 0; j < w; j++) {
+      p = s32[j] | alpha;
+      a = p >> 24;
+      if (! premul && a != 0 && a != 0xFF) {
+        p = (a << 24)
+          | (((((p >> 16) & 0xFF) * 255 + a / 2) / a) << 16)
+          | (((((p >> 8) & 0xFF) * 255 + a / 2) / a) << 8)
+          | (((p & 0xFF) * 255 + a / 2) / a);
+      }
+      d[4 * j + ir] = p >> 16;
+      d[4 * j + ig] = p >> 8;
+      d[4 * j + ib] = p;
+      d[4 * j + ia] = a;
+    }
+  }
+  return(Val_unit);
+}
+
+/* Inverse of caml_cairo_image_to_data8: read the pixels of the ARGB32
+   or RGB24 image [vsurf] from [vb]. */
+CAMLexport value caml_cairo_image_of_data8(value vb, value vorder,
+                                           value vpremul, value vstride,
+                                           value vsurf)
+{
+  /* noalloc */
+  cairo_surface_t *surf = SURFACE_VAL(vsurf);
+  const int w = cairo_image_surface_get_width(surf);
+  const int h = cairo_image_surface_get_height(surf);
+  const int stride = cairo_image_surface_get_stride(surf);
+  unsigned char *d = cairo_image_surface_get_data(surf);
+  const unsigned char *s = Caml_ba_data_val(vb);
+  const intnat sstride = Long_val(vstride);
+  const int *off = caml_cairo_channel_offsets[Int_val(vorder)];
+  const int ir = off[0], ig = off[1], ib = off[2], ia = off[3];
+  const int opaque =
+    cairo_image_surface_get_format(surf) == CAIRO_FORMAT_RGB24;
+  const int premul = Bool_val(vpremul);
+  uint32_t *d32;
+  uint32_t a, t1, t2, t3;
+  int i, j;
+
+  for(i = 0; i < h; i++, s += sstride, d += stride) {
+    d32 = (uint32_t *) d;
+    if (premul) {
+      for(j = 0; j < w; j++)
+        d32[j] = ((uint32_t) s[4 * j + ia] << 24)
+          | ((uint32_t) s[4 * j + ir] << 16)
+          | ((uint32_t) s[4 * j + ig] << 8) | s[4 * j + ib];
+    }
+    else {
+      for(j = 0; j < w; j++) {
+        a = s[4 * j + ia];
+        d32[j] = (a << 24) | (MUL_UN8(s[4 * j + ir], a, t1) << 16)
+          | (MUL_UN8(s[4 * j + ig], a, t2) << 8)
+          | MUL_UN8(s[4 * j + ib], a, t3);
+      }
+    }
+    /* The colours are premultiplied, so dropping the alpha amounts to
+       compositing over black. */
+    if (opaque)
+      for(j = 0; j < w; j++) d32[j] |= 0xFF000000;
+  }
+  return(Val_unit);
+}
+#undef MUL_UN8
+
 #else
 
 UNAVAILABLE3(cairo_image_surface_create)
 UNAVAILABLE2(cairo_format_stride_for_width)
 UNAVAILABLE5(cairo_image_surface_create_for_data8)
 UNAVAILABLE5(cairo_image_surface_create_for_data32)
+UNAVAILABLE5(cairo_image_surface_create_for_tile)
 UNAVAILABLE1(cairo_image_surface_get_UINT8)
 UNAVAILABLE1(cairo_image_surface_get_INT32)
 UNAVAILABLE1(cairo_image_surface_get_format)
 UNAVAILABLE1(cairo_image_surface_get_width)
 UNAVAILABLE1(cairo_image_surface_get_height)
 UNAVAILABLE1(cairo_image_surface_get_stride)
+UNAVAILABLE5(cairo_image_export_row)
 
 #endif /* CAIRO_HAS_IMAGE_SURFACE */
 
@@ -1774,7 +3506,7 @@ CAMLexport value caml_cairo_image_surface_create_from_png(value fname)
 
   surf = cairo_image_surface_create_from_png(String_val(fname));
   caml_cairo_raise_Error(cairo_surface_status(surf));
-  SURFACE_ASSIGN(vsurf, surf);
+  SURFACE_ASSIGN_MEM(vsurf, surf, IMAGE_SURFACE_MEM(surf));
   CAMLreturn(vsurf);
 }
 
@@ -1788,18 +3520,158 @@ CAMLexport value caml_cairo_image_surface_create_from_png_stream(value vinput)
                                                     &vinput);
   if (surf == NULL) caml_cairo_raise_Error(CAIRO_STATUS_READ_ERROR);
   caml_cairo_raise_Error(cairo_surface_status(surf));
-  SURFACE_ASSIGN(vsurf, surf);
+  SURFACE_ASSIGN_MEM(vsurf, surf, IMAGE_SURFACE_MEM(surf));
+  CAMLreturn(vsurf);
+}
+
+/* Serve cairo's read requests from a buffer already in memory. */
+struct caml_cairo_input_buffer {
+  const unsigned char *data;
+  size_t length;
+};
+
+static cairo_status_t caml_cairo_input_buffer
+(void *closure, unsigned char *data, unsigned int length)
+{
+  struct caml_cairo_input_buffer *b =
+    (struct caml_cairo_input_buffer *) closure;
+
+  if (length > b->length) return(CAIRO_STATUS_READ_ERROR);
+  memcpy(data, b->data, length);
+  b->data += length;
+  b->length -= length;
+  return(CAIRO_STATUS_SUCCESS);
+}
+
+CAMLexport value caml_cairo_image_surface_create_from_png_string(value vs)
+{
+  CAMLparam1(vs);
+  CAMLlocal1(vsurf);
+  cairo_surface_t* surf;
+  struct caml_cairo_input_buffer b;
+
+  /* Nothing is allocated in the OCaml heap while decoding (and the
+     runtime lock is kept), so the string cannot move. */
+  b.data = (const unsigned char *) String_val(vs);
+  b.length = caml_string_length(vs);
+  surf = cairo_image_surface_create_from_png_stream(&caml_cairo_input_buffer,
+                                                    &b);
+  caml_cairo_raise_Error(cairo_surface_status(surf));
+  SURFACE_ASSIGN_MEM(vsurf, surf, IMAGE_SURFACE_MEM(surf));
+  CAMLreturn(vsurf);
+}
+
+CAMLexport value caml_cairo_image_surface_create_from_png_bigarray(value vb)
+{
+  CAMLparam1(vb);
+  CAMLlocal1(vsurf);
+  cairo_surface_t* surf;
+  struct caml_cairo_input_buffer b;
+
+  /* The bigarray data does not move, decode without the runtime lock. */
+  b.data = (const unsigned char *) Caml_ba_data_val(vb);
+  b.length = caml_ba_byte_size(Caml_ba_array_val(vb));
+  RELEASE_RUNTIME_LOCK(surf = cairo_image_surface_create_from_png_stream
+                       (&caml_cairo_input_buffer, &b));
+  caml_cairo_raise_Error(cairo_surface_status(surf));
+  SURFACE_ASSIGN_MEM(vsurf, surf, IMAGE_SURFACE_MEM(surf));
   CAMLreturn(vsurf);
 }
 
 CAMLexport value caml_cairo_surface_write_to_png(value vsurf, value vfname)
 {
-  /* noalloc */
+  CAMLparam2(vsurf, vfname);
+  cairo_surface_t *surface = SURFACE_VAL(vsurf);
   cairo_status_t status;
-
-  status = cairo_surface_write_to_png(SURFACE_VAL(vsurf), String_val(vfname));
+  char *fname;
+
+  /* The OCaml string may be moved while the runtime lock is released. */
+  SET_MALLOC(fname, caml_string_length(vfname) + 1, char);
+  memcpy(fname, String_val(vfname), caml_string_length(vfname) + 1);
+  WITHOUT_RUNTIME_LOCK(surface,
+                       status = cairo_surface_write_to_png(surface, fname));
+  free(fname);
   caml_cairo_raise_Error(status);
-  return(Val_unit);
+  CAMLreturn(Val_unit);
+}
+
+/* Growable C buffer to which cairo can write without calling OCaml
+   (thus without allocating a string per chunk). */
+struct caml_cairo_buffer {
+  unsigned char *data;
+  size_t length;
+  size_t capacity;
+};
+
+static cairo_status_t caml_cairo_output_buffer
+(void *closure, const unsigned char *data, unsigned int length)
+{
+  struct caml_cairo_buffer *b = (struct caml_cairo_buffer *) closure;
+  size_t capacity;
+  unsigned char *p;
+
+  if (b->length + length > b->capacity) {
+    capacity = (b->capacity == 0) ? 4096 : b->capacity;
+    while (capacity < b->length + length) capacity *= 2;
+    p = realloc(b->data, capacity);
+    if (p == NULL) return(CAIRO_STATUS_NO_MEMORY);
+    b->data = p;
+    b->capacity = capacity;
+  }
+  memcpy(b->data + b->length, data, length);
+  b->length += length;
+  return(CAIRO_STATUS_SUCCESS);
+}
+
+/* Write the PNG to [b] ([b->data] must be freed by the caller, even
+   in case of error). */
+static cairo_status_t caml_cairo_write_png_to_buffer
+(cairo_surface_t *surface, struct caml_cairo_buffer *b)
+{
+  cairo_status_t status;
+  b->data = NULL;
+  b->length = 0;
+  b->capacity = 0;
+  WITHOUT_RUNTIME_LOCK(surface,
+                       status = cairo_surface_write_to_png_stream
+                       (surface, &caml_cairo_output_buffer, b));
+  return(status);
+}
+
+CAMLexport value caml_cairo_surface_write_to_png_string(value vsurf)
+{
+  CAMLparam1(vsurf);
+  CAMLlocal1(vs);
+  struct caml_cairo_buffer b;
+  cairo_status_t status;
+
+  status = caml_cairo_write_png_to_buffer(SURFACE_VAL(vsurf), &b);
+  if (status != CAIRO_STATUS_SUCCESS) {
+    free(b.data);
+    caml_cairo_raise_Error(status);
+  }
+  vs = caml_alloc_string(b.length);
+  memcpy((char *) String_val(vs), b.data, b.length);
+  free(b.data);
+  CAMLreturn(vs);
+}
+
+CAMLexport value caml_cairo_surface_write_to_png_bigarray(value vsurf)
+{
+  CAMLparam1(vsurf);
+  struct caml_cairo_buffer b;
+  cairo_status_t status;
+  intnat dim[1];
+
+  status = caml_cairo_write_png_to_buffer(SURFACE_VAL(vsurf), &b);
+  if (status != CAIRO_STATUS_SUCCESS) {
+    free(b.data);
+    caml_cairo_raise_Error(status);
+  }
+  /* The bigarray takes ownership of the buffer (no copy). */
+  dim[0] = b.length;
+  CAMLreturn(caml_ba_alloc(CAML_BA_UINT8 | CAML_BA_C_LAYOUT | CAML_BA_MANAGED,
+                           1, b.data, dim));
 }
 
 CAMLexport value caml_cairo_surface_write_to_png_stream(value vsurf,
@@ -1816,11 +3688,27 @@ CAMLexport value caml_cairo_surface_write_to_png_stream(value vsurf,
 
 UNAVAILABLE1(cairo_image_surface_create_from_png)
 UNAVAILABLE1(cairo_image_surface_create_from_png_stream)
+UNAVAILABLE1(cairo_image_surface_create_from_png_string)
+UNAVAILABLE1(cairo_image_surface_create_from_png_bigarray)
 UNAVAILABLE1(cairo_surface_write_to_png)
 UNAVAILABLE2(cairo_surface_write_to_png_stream)
+UNAVAILABLE1(cairo_surface_write_to_png_string)
+UNAVAILABLE1(cairo_surface_write_to_png_bigarray)
 
 #endif /* CAIRO_HAS_PNG_FUNCTIONS */
 
+/* Copy [len] bytes of the bigarray [vb] from [ofs] to the start of
+   [vbytes] (PNG.write_to_buffer checks the bounds). */
+CAMLexport value caml_cairo_png_blit_to_bytes(value vb, value vofs,
+                                              value vbytes, value vlen)
+{
+  /* noalloc */
+  memcpy((char *) String_val(vbytes),
+         (unsigned char *) Caml_ba_data_val(vb) + Long_val(vofs),
+         Long_val(vlen));
+  return(Val_unit);
+}
+
 /* Postscript surface
 ***********************************************************************/
 
@@ -1980,14 +3868,270 @@ CAMLexport value caml_cairo_recording_surface_ink_extents(value vsurf)
     CAMLreturn(vextents);
 }
 
+/* Paint the recording [vsurf] on [vcr], transformed by [vmatrix] and
+   restricted to the rectangle [vclip] of the recording, both
+   optional.  The state of [cr] (including the current path) is left
+   unchanged. */
+CAMLexport value caml_cairo_recording_surface_replay(
+  value vsurf, value vmatrix, value vclip, value vcr)
+{
+  CAMLparam4(vsurf, vmatrix, vclip, vcr);
+  cairo_t *cr = CAIRO_VAL(vcr);
+  cairo_surface_t *src = caml_cairo_surface_ok(vsurf);
+  cairo_status_t status;
+  double x = 0., y = 0., w, h;
+  value v;
+
+  if (Is_block(vclip)) /* = Some _ */ {
+    v = Field(vclip, 0);
+    x = Double_field(v, 0);
+    y = Double_field(v, 1);
+    w = Double_field(v, 2);
+    h = Double_field(v, 3);
+    if (w < 0. || h < 0.)
+      caml_invalid_argument("Cairo.Recording.replay: negative clip size");
+    /* A sub-surface rather than a clip so the current path is kept.
+       Its status is checked before it can put [cr] in an error. */
+    src = cairo_surface_create_for_rectangle(src, x, y, w, h);
+    status = cairo_surface_status(src);
+    if (status != CAIRO_STATUS_SUCCESS) {
+      cairo_surface_destroy(src);
+      caml_cairo_raise_Error(status);
+    }
+  }
+  cairo_save(cr);
+  if (Is_block(vmatrix)) {
+    value vm = Field(vmatrix, 0);
+    ALLOC_CAIRO_MATRIX(vm);
+    cairo_transform(cr, GET_MATRIX(vm));
+  }
+  cairo_set_source_surface(cr, src, x, y);
+  WITHOUT_RUNTIME_LOCK(cairo_get_target(cr), cairo_paint(cr));
+  cairo_restore(cr);
+  if (Is_block(vclip)) cairo_surface_destroy(src);
+  caml_check_status(cr);
+  CAMLreturn(Val_unit);
+}
+
 #else
 
 UNAVAILABLE2(cairo_recording_surface_create)
 UNAVAILABLE1(cairo_recording_surface_ink_extents)
+UNAVAILABLE4(cairo_recording_surface_replay)
 
 #endif /* CAIRO_HAS_RECORDING_SURFACE */
 
 
+/* Regions -- Representing a pixel-aligned area
+***********************************************************************/
+
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 10, 0)
+
+CAMLexport value caml_cairo_region_create(value unit)
+{
+  CAMLparam1(unit);
+  CAMLlocal1(vregion);
+  cairo_region_t *region = cairo_region_create();
+  caml_cairo_raise_Error(cairo_region_status(region));
+  REGION_ASSIGN(vregion, region);
+  CAMLreturn(vregion);
+}
+
+CAMLexport value caml_cairo_region_create_rectangle(value vrect)
+{
+  CAMLparam1(vrect);
+  CAMLlocal1(vregion);
+  cairo_rectangle_int_t rect;
+  cairo_region_t *region;
+  SET_RECTANGLE_INT_VAL(rect, vrect);
+  region = cairo_region_create_rectangle(&rect);
+  caml_cairo_raise_Error(cairo_region_status(region));
+  REGION_ASSIGN(vregion, region);
+  CAMLreturn(vregion);
+}
+
+CAMLexport value caml_cairo_region_create_rectangles(value vrects)
+{
+  CAMLparam1(vrects);
+  CAMLlocal1(vregion);
+  int i, n = Wosize_val(vrects);
+  cairo_rectangle_int_t *rects;
+  cairo_region_t *region;
+  if (n == 0)
+    region = cairo_region_create();
+  else {
+    SET_MALLOC(rects, n, cairo_rectangle_int_t);
+    for(i = 0; i < n; i++) {
+      SET_RECTANGLE_INT_VAL(rects[i], Field(vrects, i));
+    }
+    region = cairo_region_create_rectangles(rects, n);
+    free(rects);
+  }
+  caml_cairo_raise_Error(cairo_region_status(region));
+  REGION_ASSIGN(vregion, region);
+  CAMLreturn(vregion);
+}
+
+CAMLexport value caml_cairo_region_copy(value vregion)
+{
+  CAMLparam1(vregion);
+  CAMLlocal1(vcopy);
+  cairo_region_t *region = cairo_region_copy(REGION_VAL(vregion));
+  caml_cairo_raise_Error(cairo_region_status(region));
+  REGION_ASSIGN(vcopy, region);
+  CAMLreturn(vcopy);
+}
+
+CAMLexport value caml_cairo_region_get_extents(value vregion)
+{
+  CAMLparam1(vregion);
+  CAMLlocal1(vrect);
+  cairo_rectangle_int_t rect;
+  cairo_region_get_extents(REGION_VAL(vregion), &rect);
+  RECTANGLE_INT_ASSIGN(vrect, rect);
+  CAMLreturn(vrect);
+}
+
+CAMLexport value caml_cairo_region_num_rectangles(value vregion)
+{
+  return(Val_int(cairo_region_num_rectangles(REGION_VAL(vregion))));
+}
+
+/* Assume the index [vi] was checked. */
+CAMLexport value caml_cairo_region_get_rectangle(value vregion, value vi)
+{
+  CAMLparam2(vregion, vi);
+  CAMLlocal1(vrect);
+  cairo_rectangle_int_t rect;
+  cairo_region_get_rectangle(REGION_VAL(vregion), Int_val(vi), &rect);
+  RECTANGLE_INT_ASSIGN(vrect, rect);
+  CAMLreturn(vrect);
+}
+
+CAMLexport value caml_cairo_region_is_empty(value vregion)
+{
+  return(Val_bool(cairo_region_is_empty(REGION_VAL(vregion))));
+}
+
+CAMLexport value caml_cairo_region_contains_point(value vregion,
+                                                  value vx, value vy)
+{
+  return(Val_bool(cairo_region_contains_point(REGION_VAL(vregion),
+                                              Int_val(vx), Int_val(vy))));
+}
+
+CAMLexport value caml_cairo_region_contains_rectangle(value vregion,
+                                                      value vrect)
+{
+  cairo_rectangle_int_t rect;
+  SET_RECTANGLE_INT_VAL(rect, vrect);
+  /* Same order as the OCaml constructors: IN, OUT, PART. */
+  return(Val_int(cairo_region_contains_rectangle(REGION_VAL(vregion),
+                                                 &rect)));
+}
+
+CAMLexport value caml_cairo_region_equal(value vregion1, value vregion2)
+{
+  return(Val_bool(cairo_region_equal(REGION_VAL(vregion1),
+                                     REGION_VAL(vregion2))));
+}
+
+CAMLexport value caml_cairo_region_translate(value vregion,
+                                             value vdx, value vdy)
+{
+  cairo_region_translate(REGION_VAL(vregion), Int_val(vdx), Int_val(vdy));
+  return(Val_unit);
+}
+
+/* Set operations, modifying their first argument. */
+#define REGION_OP(name)                                                 \
+  CAMLexport value caml_cairo_region_##name(value vdst, value vother)   \
+  {                                                                     \
+    CAMLparam2(vdst, vother);                                           \
+    caml_cairo_raise_Error(cairo_region_##name(REGION_VAL(vdst),        \
+                                               REGION_VAL(vother)));    \
+    CAMLreturn(Val_unit);                                               \
+  }                                                                     \
+                                                                        \
+  CAMLexport value caml_cairo_region_##name##_rectangle(value vdst,     \
+                                                        value vrect)    \
+  {                                                                     \
+    CAMLparam2(vdst, vrect);                                            \
+    cairo_rectangle_int_t rect;                                         \
+    SET_RECTANGLE_INT_VAL(rect, vrect);                                 \
+    caml_cairo_raise_Error(cairo_region_##name##_rectangle(             \
+                             REGION_VAL(vdst), &rect));                 \
+    CAMLreturn(Val_unit);                                               \
+  }
+
+REGION_OP(union)
+REGION_OP(intersect)
+REGION_OP(subtract)
+REGION_OP(xor)
+
+CAMLexport value caml_cairo_region_clip(value vcr, value vregion)
+{
+  CAMLparam2(vcr, vregion);
+  cairo_t *cr = CAIRO_VAL(vcr);
+  cairo_region_t *region = REGION_VAL(vregion);
+  cairo_rectangle_int_t rect;
+  int i, n = cairo_region_num_rectangles(region);
+
+  cairo_new_path(cr);
+  for(i = 0; i < n; i++) {
+    cairo_region_get_rectangle(region, i, &rect);
+    cairo_rectangle(cr, rect.x, rect.y, rect.width, rect.height);
+  }
+  cairo_clip(cr);
+  caml_check_status(cr);
+  CAMLreturn(Val_unit);
+}
+
+CAMLexport value caml_cairo_region_mark_dirty(value vsurf, value vregion)
+{
+  CAMLparam2(vsurf, vregion);
+  cairo_surface_t *surface = SURFACE_VAL(vsurf);
+  cairo_region_t *region = REGION_VAL(vregion);
+  cairo_rectangle_int_t rect;
+  int i, n = cairo_region_num_rectangles(region);
+
+  for(i = 0; i < n; i++) {
+    cairo_region_get_rectangle(region, i, &rect);
+    cairo_surface_mark_dirty_rectangle(surface, rect.x, rect.y,
+                                       rect.width, rect.height);
+  }
+  caml_cairo_raise_Error(cairo_surface_status(surface));
+  CAMLreturn(Val_unit);
+}
+
+#else
+
+UNAVAILABLE1(cairo_region_create)
+UNAVAILABLE1(cairo_region_create_rectangle)
+UNAVAILABLE1(cairo_region_create_rectangles)
+UNAVAILABLE1(cairo_region_copy)
+UNAVAILABLE1(cairo_region_get_extents)
+UNAVAILABLE1(cairo_region_num_rectangles)
+UNAVAILABLE2(cairo_region_get_rectangle)
+UNAVAILABLE1(cairo_region_is_empty)
+UNAVAILABLE3(cairo_region_contains_point)
+UNAVAILABLE2(cairo_region_contains_rectangle)
+UNAVAILABLE2(cairo_region_equal)
+UNAVAILABLE3(cairo_region_translate)
+UNAVAILABLE2(cairo_region_union)
+UNAVAILABLE2(cairo_region_union_rectangle)
+UNAVAILABLE2(cairo_region_intersect)
+UNAVAILABLE2(cairo_region_intersect_rectangle)
+UNAVAILABLE2(cairo_region_subtract)
+UNAVAILABLE2(cairo_region_subtract_rectangle)
+UNAVAILABLE2(cairo_region_xor)
+UNAVAILABLE2(cairo_region_xor_rectangle)
+UNAVAILABLE2(cairo_region_clip)
+UNAVAILABLE2(cairo_region_mark_dirty)
+
+#endif
+
+
 
 /* Local Variables: */
 /* compile-command: "make -k -C.." */
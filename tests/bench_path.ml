@@ -0,0 +1,50 @@
+(* Measure the cost of the path construction functions.  The "boxed"
+   versions call the bytecode stubs, which unbox the floats and call
+   the unboxed ones, so the difference only measures the boxing of
+   the floats (the former stubs also checked the status of the
+   context).  The loops are written out for each function so that
+   the floats are not boxed by a closure call. *)
+
+open Printf
+
+external move_to_boxed : Cairo.context -> float -> float -> unit
+  = "caml_cairo_move_to"
+external line_to_boxed : Cairo.context -> float -> float -> unit
+  = "caml_cairo_line_to"
+external curve_to_boxed : Cairo.context -> float -> float -> float -> float ->
+                          float -> float -> unit
+  = "caml_cairo_curve_to_bc" "caml_cairo_curve_to"
+
+let n = 10_000_000
+let batch = 1000 (* Clear the path regularly to measure the calls only *)
+
+let time name cr loop =
+  Cairo.Path.clear cr;
+  let t0 = Sys.time() in
+  for i = 1 to n / batch do
+    loop (float i);
+    Cairo.Path.clear cr
+  done;
+  let dt = Sys.time() -. t0 in
+  printf "%-17s %6.1f ns/call\n%!" name (dt /. float n *. 1e9)
+
+let () =
+  let cr = Cairo.create(Cairo.Image.create Cairo.Image.A8 ~w:10 ~h:10) in
+  time "move_to (boxed)" cr (fun x ->
+      for j = 0 to batch - 1 do move_to_boxed cr x (float j) done);
+  time "move_to" cr (fun x ->
+      for j = 0 to batch - 1 do Cairo.move_to cr x (float j) done);
+  time "line_to (boxed)" cr (fun x ->
+      for j = 0 to batch - 1 do line_to_boxed cr x (float j) done);
+  time "line_to" cr (fun x ->
+      for j = 0 to batch - 1 do Cairo.line_to cr x (float j) done);
+  time "curve_to (boxed)" cr (fun x ->
+      for j = 0 to batch - 1 do
+        let y = float j in
+        curve_to_boxed cr x y x y x y
+      done);
+  time "curve_to" cr (fun x ->
+      for j = 0 to batch - 1 do
+        let y = float j in
+        Cairo.curve_to cr x y x y x y
+      done)
@@ -17,6 +17,46 @@ let () =
   assert(Scaled_font.get_ctm sf = Matrix.init_identity());
   assert(Scaled_font.get_font_options sf = fo)
 
+(* Bulk transformations *)
+let () =
+  let open Bigarray in
+  let pts = Array1.of_array float64 c_layout [| 1.; 2.; -3.; 0.5; 0.; 0. |] in
+  let same_as f dst =
+    for i = 0 to Array1.dim pts / 2 - 1 do
+      let x, y = f pts.{2 * i} pts.{2 * i + 1} in
+      assert(abs_float(dst.{2 * i} -. x) < 1e-9);
+      assert(abs_float(dst.{2 * i + 1} -. y) < 1e-9)
+    done in
+  let dst = Array1.create float64 c_layout (Array1.dim pts) in
+  let m = { xx = 1.; xy = 2.; yx = 3.; yy = 4.; x0 = 5.; y0 = 6. } in
+  Matrix.transform_points m pts ~dst;
+  same_as (Matrix.transform_point m) dst;
+  Matrix.transform_distances m pts ~dst;
+  same_as (fun dx dy -> Matrix.transform_distance m ~dx ~dy) dst;
+  let surf = Image.create Image.ARGB32 ~w:10 ~h:10 in
+  Surface.set_device_offset surf 7. (-2.);
+  let cr = create surf in
+  translate cr 3. 4.;
+  rotate cr 0.3;
+  scale cr 2. 0.5;
+  user_to_device_points cr pts ~dst;
+  same_as (user_to_device cr) dst;
+  user_to_device_distances cr pts ~dst;
+  same_as (user_to_device_distance cr) dst;
+  device_to_user_points cr pts ~dst;
+  same_as (device_to_user cr) dst;
+  device_to_user_distances cr pts ~dst;
+  same_as (device_to_user_distance cr) dst;
+  (* In place. *)
+  let copy = Array1.create float64 c_layout (Array1.dim pts) in
+  Array1.blit pts copy;
+  user_to_device_points cr copy;
+  user_to_device_points cr pts ~dst;
+  assert(copy = dst);
+  (match Matrix.transform_points m (Array1.sub pts 0 3) with
+   | () -> assert false
+   | exception Invalid_argument _ -> ())
+
 
 (* Local Variables: *)
 (* compile-command: "make -k -C.." *)
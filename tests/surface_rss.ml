@@ -0,0 +1,30 @@
+open Printf
+open Cairo
+
+(* Resident set size in MB (Linux only). *)
+let rss () =
+  try
+    let fh = open_in "/proc/self/statm" in
+    let pages = Scanf.bscanf (Scanf.Scanning.from_channel fh) "%_d %d"
+                  (fun n -> n) in
+    close_in fh;
+    Some (pages * 4096 / 1_000_000)
+  with _ -> None
+
+(* Each surface is 16MB.  Without telling the GC how much memory the
+   surfaces hold, hundreds of them accumulate before being finalized. *)
+let () =
+  match rss () with
+  | None -> printf "Cannot read the RSS, test skipped.\n"
+  | Some rss0 ->
+     let max_rss = ref rss0 in
+     for _i = 1 to 200 do
+       let cr = create (Image.create Image.ARGB32 ~w:2000 ~h:2000) in
+       set_source_rgb cr 0.5 0.5 0.5;
+       paint cr; (* touch all the pixels *)
+       match rss () with
+       | Some r -> max_rss := max !max_rss r
+       | None -> ()
+     done;
+     printf "RSS: initial %d MB, max %d MB\n" rss0 !max_rss;
+     assert(!max_rss - rss0 < 800)
@@ -0,0 +1,44 @@
+open Cairo
+
+let () =
+  let img = Image.create Image.ARGB32 ~w:3 ~h:2 in
+  let d = Image.get_data32 img in
+  d.{0, 0} <- 0xFF102030l;
+  d.{0, 1} <- 0x80400000l; (* red 0x80 with alpha 0x80 premultiplied *)
+  d.{0, 2} <- 0l;
+  Surface.mark_dirty img;
+  (* Straight RGBA bytes, rows padded to 16 bytes. *)
+  let b = Bigarray.(Array1.create int8_unsigned c_layout 32) in
+  Image.convert_to_data8 img ~stride:16 b;
+  assert(b.{0} = 0x10 && b.{1} = 0x20 && b.{2} = 0x30 && b.{3} = 0xFF);
+  assert(b.{4} = 0x80 && b.{5} = 0 && b.{6} = 0 && b.{7} = 0x80);
+  assert(b.{8} = 0 && b.{11} = 0);
+  Image.convert_to_data8 img ~order:`BGRA ~premultiplied:true ~stride:16 b;
+  assert(b.{4} = 0 && b.{5} = 0 && b.{6} = 0x40 && b.{7} = 0x80);
+  (* Back to the surface. *)
+  Image.convert_to_data8 img ~order:`ARGB ~stride:16 b;
+  let img2 = Image.create Image.ARGB32 ~w:3 ~h:2 in
+  Image.convert_of_data8 b ~order:`ARGB ~stride:16 img2;
+  let d2 = Image.get_data32 img2 in
+  assert(d2.{0, 0} = 0xFF102030l && d2.{0, 1} = 0x80400000l);
+  (try Image.convert_to_data8 img ~stride:8 b; assert false
+   with Invalid_argument _ -> ());
+  (* Format conversions. *)
+  let rgb = Image.create Image.RGB24 ~w:3 ~h:2 in
+  Image.convert img rgb;
+  assert(Int32.logand (Image.get_data32 rgb).{0, 1} 0xFFFFFFl = 0x400000l);
+  let a8 = Image.create Image.A8 ~w:3 ~h:2 in
+  Image.convert img a8;
+  let d8 = Image.get_data8 a8 in
+  assert(d8.{0} = 0xFF && d8.{1} = 0x80 && d8.{2} = 0);
+  Image.convert rgb a8;
+  assert(d8.{1} = 0xFF);
+  (* Straight alpha round trip. *)
+  Image.unpremultiply d;
+  assert(d.{0, 1} = 0x80800000l);
+  Image.premultiply d;
+  assert(d.{0, 1} = 0x80400000l && d.{0, 0} = 0xFF102030l);
+  (* Invalid pixels (colour above the alpha) saturate. *)
+  d.{0, 1} <- 0x10FF0000l;
+  Image.unpremultiply d;
+  assert(d.{0, 1} = 0x10FF0000l)
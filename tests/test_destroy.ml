@@ -0,0 +1,56 @@
+open Printf
+open Cairo
+
+let raises name f =
+  match f () with
+  | () -> printf "%s: no exception raised\n" name;  exit 1
+  | exception (Error _ | Out_of_memory as e) ->
+     printf "%s: raised %s as expected\n" name (Printexc.to_string e)
+
+(* Using a destroyed value must not put the context in error. *)
+let still_usable name cr =
+  rectangle cr 0. 0. ~w:1. ~h:1.;
+  fill cr;
+  printf "%s: context still usable\n" name
+
+let () =
+  let surf = Image.create Image.ARGB32 ~w:100 ~h:100 in
+  let cr = with_context surf (fun cr ->
+               rectangle cr 10. 10. ~w:50. ~h:50.;
+               fill cr;
+               cr) in
+  raises "Cairo.destroy" (fun () -> rectangle cr 0. 0. ~w:1. ~h:1.;  fill cr);
+  destroy cr;
+
+  let cr = create surf in
+  let pat = Pattern.create_rgb 1. 0. 0. in
+  Pattern.with_pattern pat (fun pat -> set_source cr pat;  paint cr);
+  raises "Pattern.destroy" (fun () -> set_source cr pat);
+  still_usable "Pattern.destroy" cr;
+  raises "Pattern.destroy (mask)" (fun () -> mask cr pat);
+  still_usable "Pattern.destroy (mask)" cr;
+  destroy cr;
+
+  let cr = create surf in
+  move_to cr 10. 10.;
+  line_to cr 20. 20.;
+  let path = Path.copy cr in
+  Path.with_path path (fun path -> Path.append cr path);
+  Path.destroy path;
+  raises "Path.destroy" (fun () -> Path.append cr path);
+  still_usable "Path.destroy" cr;
+  destroy cr;
+
+  let cr = create surf in
+  let src = Image.create Image.ARGB32 ~w:10 ~h:10 in
+  Surface.destroy src;
+  raises "Surface.destroy" (fun () -> set_source_surface cr src ~x:0. ~y:0.);
+  still_usable "Surface.destroy" cr;
+  raises "Surface.destroy (pattern)"
+    (fun () -> ignore(Pattern.create_for_surface src));
+  destroy cr;
+
+  Surface.destroy surf;
+  Surface.destroy surf;
+  (* The finalizers must cope with destroyed values. *)
+  Gc.compact()
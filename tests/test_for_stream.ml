@@ -19,3 +19,35 @@ let () =
   make Cairo.SVG.create_for_stream (Filename.concat tmp "cairo-test.svg");
   Gc.major();
   make Cairo.PDF.create_for_stream (Filename.concat tmp "cairo-test.pdf");
+
+(* The in-memory PNG encoders must agree with the stream one. *)
+let () =
+  let surface = Cairo.Image.(create ARGB32 ~w:100 ~h:100) in
+  let ctx = Cairo.create surface in
+  Cairo.arc ctx 50. 50. ~r:30. ~a1:0. ~a2:6.;
+  Cairo.fill ctx;
+  let b = Buffer.create 1024 in
+  Cairo.PNG.write_to_stream surface (Buffer.add_string b);
+  let png = Buffer.contents b in
+  assert(Cairo.PNG.write_to_string surface = png);
+  let ba = Cairo.PNG.write_to_bigarray surface in
+  assert(Bigarray.Array1.dim ba = String.length png);
+  String.iteri (fun i c -> assert(ba.{i} = Char.code c)) png;
+  Buffer.clear b;
+  Cairo.PNG.write_to_buffer surface b;
+  assert(Buffer.contents b = png);
+  printf "PNG written to memory (%d bytes).\n" (String.length png)
+
+(* Decoding from memory. *)
+let () =
+  let surface = Cairo.Image.(create ARGB32 ~w:40 ~h:30) in
+  let png = Cairo.PNG.write_to_string surface in
+  let check s =
+    assert(Cairo.Image.get_width s = 40 && Cairo.Image.get_height s = 30) in
+  check (Cairo.PNG.of_string png);
+  check (Cairo.PNG.of_bigarray (Cairo.PNG.write_to_bigarray surface));
+  (try
+     ignore(Cairo.PNG.of_string (String.sub png 0 (String.length png / 2)));
+     assert false
+   with Cairo.Error _ -> ());
+  printf "PNG read from memory.\n"
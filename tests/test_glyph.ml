@@ -0,0 +1,73 @@
+open Printf
+open Cairo
+
+let () =
+  let surf = Image.create Image.ARGB32 ~w:200 ~h:100 in
+  let cr = create surf in
+  select_font_face cr "sans";
+  set_font_size cr 20.;
+  let glyphs = Array.init 100 (fun i ->
+                   { Glyph.index = 36 + i mod 26;
+                     x = 10. +. 12. *. float(i mod 15);
+                     y = 30. +. 25. *. float(i / 15) }) in
+  let b = Glyph.Buffer.create ~size:4 () in
+  Array.iter (fun g -> Glyph.Buffer.add b g.Glyph.index g.Glyph.x g.Glyph.y)
+    glyphs;
+  assert(Glyph.Buffer.length b = 100);
+  assert(Glyph.Buffer.to_array b = glyphs);
+  assert(Glyph.Buffer.get_x b 17 = glyphs.(17).Glyph.x);
+  assert(Glyph.extents cr glyphs = Glyph.Buffer.extents cr b);
+  Glyph.Buffer.set b 0 ~index:40 ~x:1. ~y:2.;
+  assert(Glyph.Buffer.get b 0 = { Glyph.index = 40;  x = 1.;  y = 2. });
+  (try Glyph.Buffer.set b 100 ~index:0 ~x:0. ~y:0.;  assert false
+   with Invalid_argument _ -> ());
+  Glyph.Buffer.show cr b;
+  Glyph.Buffer.path cr b;
+  fill cr;
+  Glyph.Buffer.clear b;
+  assert(Glyph.Buffer.length b = 0);
+  Glyph.Buffer.show cr b;
+  printf "Glyph buffers: OK\n"
+
+let () =
+  let surf = Image.create Image.ARGB32 ~w:200 ~h:100 in
+  let cr = create surf in
+  select_font_face cr "sans";
+  let sf = Scaled_font.get cr in
+  let b = Glyph.Buffer.create ~size:2 () in
+  List.iter (fun s ->
+      let glyphs, clusters, _ = Scaled_font.text_to_glyphs sf ~x:5. ~y:20. s in
+      let n = Scaled_font.text_to_glyph_buffer sf ~x:5. ~y:20. s b in
+      assert(n = Array.length glyphs);
+      assert(Glyph.Buffer.to_array b = glyphs);
+      assert(Glyph.Buffer.num_clusters b = Array.length clusters);
+      Array.iteri (fun i c -> assert(Glyph.Buffer.get_cluster b i = c))
+        clusters;
+      Glyph.Buffer.show_text cr s b
+    ) ["Hello";  "A longer string to make the buffer grow";  "";  "éè"];
+  printf "text_to_glyph_buffer: OK\n"
+
+let () =
+  let surf = Image.create Image.ARGB32 ~w:200 ~h:100 in
+  let cr = create surf in
+  select_font_face cr "sans";
+  let cache = Scaled_font.Cache.create ~size:2 () in
+  move_to cr 10. 50.;
+  show_text cr "Axis";
+  let expected = Path.get_current_point cr in
+  move_to cr 10. 50.;
+  Scaled_font.Cache.show_text cache cr "Axis";
+  let x, y = Path.get_current_point cr in
+  assert(abs_float(x -. fst expected) < 1e-9
+         && abs_float(y -. snd expected) < 1e-9);
+  List.iter (Scaled_font.Cache.show_text cache cr) ["Axis"; "Legend"; "Axis"];
+  assert(Scaled_font.Cache.misses cache = 2);
+  assert(Scaled_font.Cache.hits cache = 2);
+  (* "Legend" is the least recently used run, it is evicted. *)
+  Scaled_font.Cache.show_text cache cr "Title";
+  assert(Scaled_font.Cache.length cache = 2);
+  Scaled_font.Cache.show_text cache cr "Axis";
+  assert(Scaled_font.Cache.hits cache = 3);
+  Scaled_font.Cache.show_text cache cr "Legend";
+  assert(Scaled_font.Cache.misses cache = 4);
+  printf "Glyph run cache: OK\n"
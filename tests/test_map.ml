@@ -0,0 +1,41 @@
+open Cairo
+
+let () =
+  let img = Image.create Image.ARGB32 ~w:20 ~h:10 in
+  let cr = create img in
+  set_source_rgb cr 1. 0. 0.;
+  paint cr;
+  Surface.flush img;
+  let pixels = Image.get_data32 img in
+  match Image.map_data32 img (fun d -> d) with
+  | exception Unavailable -> print_endline "map_to_image unavailable"
+  | d ->
+     (* The array is emptied once the image is unmapped. *)
+     assert(Bigarray.Array2.dim1 d = 0);
+     (* Whole surface: the pixels are shared. *)
+     Image.map_data32 img (fun d ->
+         assert(Bigarray.Array2.dim1 d = 10 && Bigarray.Array2.dim2 d = 20);
+         assert(d.{3, 2} = 0xFFFF0000l);
+         d.{3, 2} <- 0xFF0000FFl);
+     assert(pixels.{3, 2} = 0xFF0000FFl);
+     (* A rectangle at the bottom right corner. *)
+     Image.map_data32 img ~x:14 ~y:8 ~w:6 ~h:2 (fun d ->
+         assert(Bigarray.Array2.dim1 d = 2 && Bigarray.Array2.dim2 d = 6);
+         assert(d.{0, 0} = 0xFFFF0000l);
+         Bigarray.Array2.fill d 0xFF00FF00l);
+     Surface.mark_dirty img;
+     assert(pixels.{8, 14} = 0xFF00FF00l);
+     assert(pixels.{9, 19} = 0xFF00FF00l);
+     assert(pixels.{8, 13} = 0xFFFF0000l);
+     assert(pixels.{7, 14} = 0xFFFF0000l);
+     (* The image given to [f] is released afterwards (and behaves as a
+        destroyed surface). *)
+     let image = Image.map img ~x:2 ~y:2 ~w:4 ~h:4 (fun i ->
+                     assert(Image.get_width i = 4);
+                     i) in
+     assert(Image.get_width image = 0);
+     (try Image.map img ~w:3 (fun _ -> assert false)
+      with Invalid_argument _ -> ());
+     let a8 = Image.create Image.A8 ~w:8 ~h:8 in
+     (try Image.map_data32 a8 (fun _ -> assert false)
+      with Invalid_argument _ -> ())
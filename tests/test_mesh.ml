@@ -0,0 +1,46 @@
+open Cairo
+
+let () =
+  match Pattern.Mesh.create () with
+  | exception Unavailable -> print_endline "Mesh patterns unavailable"
+  | pat ->
+     let module M = Pattern.Mesh in
+     M.begin_patch pat;
+     M.move_to pat 0. 0.;
+     M.line_to pat 10. 0.;
+     M.line_to pat 10. 10.;
+     M.line_to pat 0. 10.;
+     M.set_corner_color_rgb pat 0 1. 0. 0.;
+     M.set_corner_color_rgba pat 2 0. 0. 1. 0.5;
+     M.end_patch pat;
+     assert(M.get_patch_count pat = 1);
+     assert(M.get_corner_color_rgba pat 0 0 = (1., 0., 0., 1.));
+     assert(M.get_corner_color_rgba pat 0 2 = (0., 0., 1., 0.5));
+     (try ignore(M.get_corner_color_rgba pat 1 0);  assert false
+      with Error INVALID_INDEX -> ());
+     (try M.end_patch pat;  assert false
+      with Error INVALID_MESH_CONSTRUCTION -> ());
+     (* Bulk construction: two green triangles covering [20,40]². *)
+     let pat = M.create () in
+     let pts = Bigarray.(Array1.of_array float64 c_layout
+                           [| 20.; 20.;  40.; 20.;  40.; 40.;
+                              20.; 20.;  40.; 40.;  20.; 40. |]) in
+     let colors = Bigarray.(Array1.create float64 c_layout 24) in
+     for i = 0 to 5 do
+       colors.{4 * i} <- 0.;  colors.{4 * i + 1} <- 1.;
+       colors.{4 * i + 2} <- 0.;  colors.{4 * i + 3} <- 1.
+     done;
+     M.add_triangles pat pts colors;
+     assert(M.get_patch_count pat = 2);
+     (try M.add_quads pat pts colors;  assert false
+      with Invalid_argument _ -> ());
+     let img = Image.create Image.RGB24 ~w:50 ~h:50 in
+     let cr = create img in
+     set_source cr pat;
+     paint cr;
+     Surface.flush img;
+     let data = Image.get_data32 img in
+     let px = Int32.to_int data.{35, 25} in
+     assert((px lsr 16) land 0xFF < 5 && (px lsr 8) land 0xFF > 250
+            && px land 0xFF < 5);
+     assert(Int32.logand data.{10, 10} 0xFFFFFFl = 0l)
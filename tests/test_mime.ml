@@ -0,0 +1,44 @@
+open Cairo
+
+let jpeg = "\xFF\xD8\xFF\xE0 not really a JPEG \xFF\xD9"
+
+let () =
+  let img = Image.create Image.RGB24 ~w:4 ~h:4 in
+  match Surface.set_mime_data img Surface.Mime.jpeg jpeg with
+  | exception Unavailable -> print_endline "MIME data unavailable"
+  | () ->
+     assert(Surface.get_mime_data img Surface.Mime.jpeg = Some jpeg);
+     assert(Surface.get_mime_data img Surface.Mime.png = None);
+     Surface.remove_mime_data img Surface.Mime.jpeg;
+     assert(Surface.get_mime_data img Surface.Mime.jpeg = None);
+     (* Bigarrays are shared with the surface and stay alive with it. *)
+     let len = String.length jpeg in
+     let b = Bigarray.(Array1.create int8_unsigned c_layout (2 * len)) in
+     String.iteri (fun i c -> b.{len + i} <- Char.code c) jpeg;
+     Surface.set_mime_data_bigarray img Surface.Mime.jpeg
+       (Bigarray.Array1.sub b len len);
+     Gc.full_major ();
+     assert(Surface.get_mime_data img Surface.Mime.jpeg = Some jpeg);
+     Surface.set_mime_data img Surface.Mime.unique_id "img-1";
+     (* Drawing on the surface discards its MIME data. *)
+     let cr = create img in
+     set_source_rgb cr 1. 0. 0.;
+     paint cr;
+     Surface.flush img;
+     assert(Surface.get_mime_data img Surface.Mime.jpeg = None);
+     (* The same image used twice in a PDF. *)
+     let fname = Filename.temp_file "cairo" ".pdf" in
+     (match PDF.create fname ~w:100. ~h:100. with
+      | exception Unavailable -> ()
+      | pdf ->
+         let cr = create pdf in
+         Surface.set_mime_data img Surface.Mime.unique_id "img-1";
+         set_source_surface cr img ~x:0. ~y:0.;
+         paint cr;
+         set_source_surface cr img ~x:50. ~y:50.;
+         paint cr;
+         (match Surface.supports_mime_type pdf Surface.Mime.jpeg with
+          | b -> assert b
+          | exception Unavailable -> ());
+         Surface.finish pdf);
+     Sys.remove fname
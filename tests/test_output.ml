@@ -0,0 +1,36 @@
+open Printf
+open Cairo
+
+let read_file fname =
+  let fh = open_in_bin fname in
+  let s = really_input_string fh (in_channel_length fh) in
+  close_in fh;
+  s
+
+let output_to_string format surf =
+  let fname = Filename.temp_file "cairo" ".img" in
+  let fh = open_out_bin fname in
+  Image.output fh format surf;
+  close_out fh;
+  let s = read_file fname in
+  Sys.remove fname;
+  s
+
+let () =
+  let surf = Image.create Image.ARGB32 ~w:3 ~h:2 in
+  let cr = create surf in
+  (* Premultiplied: 0x80800000 *)
+  set_source_rgba cr 1. 0. 0. (128. /. 255.);
+  paint cr;
+  let pixels p = String.concat "" (Array.to_list (Array.make 6 p)) in
+  let s = output_to_string Image.PPM surf in
+  assert(s = "P6\n3 2\n255\n" ^ pixels "\128\000\000");
+  let s = output_to_string Image.RGBA surf in
+  assert(s = pixels "\128\000\000\128");
+  let s = output_to_string Image.BGRA surf in
+  assert(s = pixels "\000\000\128\128");
+  let s = output_to_string Image.PAM surf in
+  let hdr = "P7\nWIDTH 3\nHEIGHT 2\nDEPTH 4\nMAXVAL 255\n\
+             TUPLTYPE RGB_ALPHA\nENDHDR\n" in
+  assert(s = hdr ^ pixels "\255\000\000\128");
+  printf "Image.output: OK\n"
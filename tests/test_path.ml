@@ -34,3 +34,67 @@ let () =
 
   Cairo.stroke cr;
   Cairo.Surface.finish surface
+
+(* Bulk submission from a bigarray *)
+let () =
+  let cr = Cairo.create(Cairo.Image.create Cairo.Image.A8 ~w:10 ~h:10) in
+  let points = Bigarray.(Array1.of_array float64 c_layout
+                           [| 0.; 0.;  10.; 0.;  10.; 10. |]) in
+  Path.lines_of_bigarray cr points ~closed:true;
+  let p = Path.to_array (Path.copy cr) in
+  printf "lines_of_bigarray: %a\n%!" print_path p;
+  assert(Array.sub p 0 4 = [| MOVE_TO(0., 0.); LINE_TO(10., 0.);
+                              LINE_TO(10., 10.); CLOSE_PATH |]);
+  Path.clear cr;
+  let curve = Bigarray.(Array1.of_array float64 c_layout
+                          [| 0.; 0.;  1.; 2.;  3.; 4.;  5.; 6. |]) in
+  Path.curves_of_bigarray cr curve;
+  assert(Path.to_array (Path.copy cr)
+         = [| MOVE_TO(0., 0.); CURVE_TO(1., 2., 3., 4., 5., 6.) |])
+
+(* Packed representation *)
+let () =
+  let cr = Cairo.create(Cairo.Image.create Cairo.Image.A8 ~w:10 ~h:10) in
+  move_to cr 1. 2.;
+  curve_to cr 3. 4. 5. 6. 7. 8.;
+  let data = Path.to_bigarray (Path.copy cr) in
+  Gc.compact(); (* The view must keep the data alive *)
+  assert(Bigarray.Array2.dim1 data = 6);
+  assert(Path.get_type data 0 = Path.PATH_MOVE_TO);
+  assert(Path.get_length data 0 = 2);
+  assert(data.{1,0} = 1. && data.{1,1} = 2.);
+  assert(Path.get_type data 2 = Path.PATH_CURVE_TO);
+  assert(data.{5,0} = 7. && data.{5,1} = 8.);
+  let data = Bigarray.(Array2.create float64 c_layout 3 2) in
+  Path.set_header data 0 Path.PATH_MOVE_TO;
+  data.{1,0} <- 10.;  data.{1,1} <- 20.;
+  Path.set_header data 2 Path.PATH_CLOSE_PATH;
+  assert(Path.to_array (Path.of_bigarray data)
+         = [| MOVE_TO(10., 20.); CLOSE_PATH |]);
+  Path.set_header data 0 Path.PATH_CURVE_TO;
+  try ignore(Path.of_bigarray data);  assert false
+  with Error INVALID_PATH_DATA -> ()
+
+(* Hit testing many points at once *)
+let () =
+  let cr = Cairo.create(Cairo.Image.create Cairo.Image.A8 ~w:10 ~h:10) in
+  let pts = Bigarray.(Array1.of_array float64 c_layout
+                        [| 5.; 5.;  1.; 1.;  12.; 5.;  3.; 5. |]) in
+  rectangle cr 2. 2. ~w:6. ~h:6.;
+  set_line_width cr 2.;
+  let fill = in_fill_many cr pts in
+  let stroke = in_stroke_many cr pts in
+  for i = 0 to 3 do
+    let x = pts.{2 * i} and y = pts.{2 * i + 1} in
+    assert(fill.{i} = (if in_fill cr x y then 1 else 0));
+    assert(stroke.{i} = (if in_stroke cr x y then 1 else 0))
+  done;
+  assert(fill.{0} = 1 && fill.{1} = 0 && fill.{2} = 0);
+  assert(stroke.{3} = 1);
+  Cairo.clip cr;
+  (match in_clip_many cr pts ~dst:fill with
+   | clip -> assert(clip == fill);
+             assert(clip.{0} = 1 && clip.{1} = 0 && clip.{2} = 0)
+   | exception Unavailable -> ());
+  (try ignore(in_fill_many cr (Bigarray.Array1.sub pts 0 3));  assert false
+   with Invalid_argument _ -> ())
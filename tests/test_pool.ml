@@ -0,0 +1,67 @@
+open Cairo
+
+let bytes = 4 * 30 * 40
+
+(* Not using [Image.get_data32 img] which would take the buffer of
+   [img] out of the pool. *)
+let red_pixel img =
+  let px = Image.create Image.ARGB32 ~w:1 ~h:1 in
+  let cr = create px in
+  set_source_surface cr img ~x:(-5.) ~y:(-5.);
+  paint cr;
+  destroy cr;
+  Surface.flush px;
+  (Image.get_data32 px).{0, 0} = 0xFFFF0000l
+
+let () =
+  let pool = Image.Pool.create ~budget:(2 * bytes) () in
+  let img = Image.Pool.create_image pool Image.ARGB32 ~w:30 ~h:40 in
+  assert(Image.Pool.misses pool = 1 && Image.Pool.size pool = 0);
+  let cr = create img in
+  set_source_rgb cr 1. 0. 0.;
+  paint cr;
+  destroy cr;
+  Surface.destroy img;
+  assert(Image.Pool.size pool = bytes);
+  (* The buffer is reused, with its pixels if asked. *)
+  let img = Image.Pool.create_image pool ~zeroed:false Image.ARGB32
+              ~w:30 ~h:40 in
+  assert(Image.Pool.hits pool = 1 && Image.Pool.size pool = 0);
+  Surface.flush img;
+  assert(red_pixel img);
+  Surface.finish img;
+  assert(Image.Pool.size pool = bytes);
+  let img = Image.Pool.create_image pool Image.ARGB32 ~w:30 ~h:40 in
+  assert(Image.Pool.hits pool = 2);
+  assert(not(red_pixel img));
+  (* Other sizes do not match. *)
+  let imgs = Array.init 3 (fun _ ->
+                 Image.Pool.create_image pool Image.RGB24 ~w:30 ~h:60) in
+  assert(Image.Pool.misses pool = 4);
+  Array.iter Surface.destroy imgs;
+  (* Only the buffers within the budget are kept. *)
+  assert(Image.Pool.size pool = 4 * 30 * 60);
+  Gc.full_major ();
+  Surface.destroy img;
+  assert(Image.Pool.size pool = 4 * 30 * 60);
+  Image.Pool.clear pool;
+  assert(Image.Pool.size pool = 0);
+  (* Buffers viewed by bigarrays leave the pool. *)
+  let img = Image.Pool.create_image pool Image.ARGB32 ~w:30 ~h:40 in
+  let data = Image.get_data32 img in
+  Surface.destroy img;
+  assert(Image.Pool.size pool = 0);
+  data.{39, 29} <- 0l;
+  (match Image.Pool.create_image pool Image.ARGB32 ~w:30 ~h:(-1) with
+   | _ -> assert false
+   | exception Error INVALID_SIZE -> ());
+  (match Image.Pool.create_image pool Image.ARGB32 ~w:(-1) ~h:30 with
+   | _ -> assert false
+   | exception Error INVALID_SIZE -> ());
+  (* Buffers may outlive their pool. *)
+  let img =
+    let pool = Image.Pool.create () in
+    Image.Pool.create_image pool Image.A8 ~w:10 ~h:10 in
+  Gc.full_major ();
+  assert(Image.get_width img = 10);
+  Surface.destroy img
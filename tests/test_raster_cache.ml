@@ -0,0 +1,58 @@
+open Printf
+open Cairo
+
+let () =
+  let recording = Recording.create COLOR_ALPHA in
+  let cr = create recording in
+  set_source_rgb cr 1. 0. 0.;
+  rectangle cr 10. 10. ~w:20. ~h:20.;
+  fill cr;
+  let draw ?cache x y =
+    let img = Image.create Image.ARGB32 ~w:100 ~h:100 in
+    let cr = create img in
+    translate cr x y;
+    scale cr 2. 2.;
+    (match cache with
+     | Some c -> Raster_cache.replay c recording cr
+     | None -> Recording.replay recording cr);
+    Surface.flush img;
+    Image.get_data32 img in
+  let c = Raster_cache.create ~budget:(45 * 45 * 4) () in
+  let d = draw 5. 3. in
+  let d1 = draw ~cache:c 5. 3. in
+  let d2 = draw ~cache:c 5. 3. in
+  assert(d1 = d && d2 = d);
+  assert(Raster_cache.hits c = 1 && Raster_cache.misses c = 1);
+  assert(Raster_cache.length c = 1);
+  printf "Raster cache: %d bytes\n" (Raster_cache.size c);
+  (* Same subpixel offset, different integer translation: reused. *)
+  assert(draw ~cache:c 17. 8. = draw 17. 8.);
+  assert(Raster_cache.hits c = 2);
+  (* A new offset needs a new raster and the budget only allows one. *)
+  ignore(draw ~cache:c 5.5 3.);
+  assert(Raster_cache.misses c = 2 && Raster_cache.evictions c = 1);
+  assert(Raster_cache.length c = 1);
+  Raster_cache.invalidate c recording;
+  assert(Raster_cache.length c = 0 && Raster_cache.size c = 0);
+  (* Invalidating a destroyed recording. *)
+  ignore(draw ~cache:c 5. 3.);
+  assert(Raster_cache.length c = 1);
+  Surface.destroy recording;
+  Raster_cache.invalidate c recording;
+  assert(Raster_cache.length c = 0 && Raster_cache.size c = 0)
+
+let () =
+  (* Rasters over the budget are not created: the recording is
+     replayed directly. *)
+  let recording = Recording.create COLOR_ALPHA in
+  let cr = create recording in
+  set_source_rgb cr 0. 0. 1.;
+  rectangle cr 0. 0. ~w:1000. ~h:1000.;
+  fill cr;
+  let c = Raster_cache.create ~budget:1000 () in
+  let img = Image.create Image.ARGB32 ~w:50 ~h:50 in
+  let cr = create img in
+  Raster_cache.replay c recording cr;
+  Surface.flush img;
+  assert((Image.get_data32 img).{25, 25} = 0xFF0000FFl);
+  assert(Raster_cache.length c = 0 && Raster_cache.misses c = 0)
@@ -0,0 +1,32 @@
+open Cairo
+
+let () =
+  let acquired = ref 0 and released = ref 0 in
+  let acquire _target x y w h =
+    incr acquired;
+    let img = Image.create Image.ARGB32 ~w ~h in
+    Surface.set_device_offset img (float(- x)) (float(- y));
+    let cr = create img in
+    set_source_rgb cr 1. 0. 0.;
+    paint cr;
+    img in
+  let release _ = incr released in
+  match Pattern.create_raster_source ~w:100 ~h:100 ~release acquire with
+  | exception Unavailable -> print_endline "Raster sources unavailable"
+  | pat ->
+     let img = Image.create Image.ARGB32 ~w:50 ~h:50 in
+     let cr = create img in
+     set_source cr pat;
+     rectangle cr 10. 10. ~w:20. ~h:20.;
+     fill cr;
+     Surface.flush img;
+     assert(!acquired >= 1 && !released = !acquired);
+     let data = Image.get_data32 img in
+     assert(data.{20, 20} = 0xFFFF0000l);
+     assert(data.{5, 5} = 0l);
+     (* An exception in [acquire] must not crash. *)
+     let pat = Pattern.create_raster_source ~w:100 ~h:100
+                 (fun _ _ _ _ _ -> failwith "acquire") in
+     let cr = create img in
+     set_source cr pat;
+     (try paint cr with Error _ -> ())
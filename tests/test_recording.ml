@@ -0,0 +1,40 @@
+open Printf
+open Cairo
+
+let close r1 r2 =
+  abs_float(r1.x -. r2.x) < 1e-6 && abs_float(r1.y -. r2.y) < 1e-6
+  && abs_float(r1.w -. r2.w) < 1e-6 && abs_float(r1.h -. r2.h) < 1e-6
+
+let () =
+  let recording = Recording.create COLOR_ALPHA in
+  let cr = create recording in
+  set_source_rgb cr 1. 0. 0.;
+  rectangle cr 10. 10. ~w:20. ~h:20.;
+  fill cr;
+  set_source_rgb cr 0. 0. 1.;
+  rectangle cr 40. 10. ~w:20. ~h:20.;
+  fill cr;
+  let img = Image.create Image.ARGB32 ~w:200 ~h:100 in
+  let cr = create img in
+  move_to cr 1. 2.;
+  let matrix = Matrix.init_scale 2. 2. in
+  let clip = { x = 0.;  y = 0.;  w = 35.;  h = 50. } in
+  Recording.replay recording cr ~matrix ~clip;
+  (* The state of [cr] is untouched. *)
+  assert(Path.get_current_point cr = (1., 2.));
+  Surface.flush img;
+  let data = Image.get_data32 img in
+  assert(data.{30, 30} = 0xFFFF0000l);
+  assert(data.{50, 100} = 0l); (* blue square clipped out *)
+  assert(data.{10, 10} = 0l);
+  let e = Recording.replay_extents recording ~matrix ~clip () in
+  printf "Replay extents: x=%g y=%g w=%g h=%g\n" e.x e.y e.w e.h;
+  assert(close e { x = 20.;  y = 20.;  w = 50.;  h = 40. });
+  translate cr 5. 5.;
+  let e = Recording.replay_device_extents recording ~matrix ~clip cr in
+  assert(close e { x = 25.;  y = 25.;  w = 50.;  h = 40. });
+  (try Recording.replay recording cr ~clip:{ clip with w = -1. };
+       assert false
+   with Invalid_argument _ -> ());
+  (* [cr] is not left in an error state. *)
+  Recording.replay recording cr ~clip
@@ -0,0 +1,38 @@
+open Cairo
+
+let () =
+  match Region.create () with
+  | exception Unavailable -> print_endline "Regions unavailable (Cairo < 1.10)"
+  | r ->
+     assert(Region.is_empty r);
+     Region.union_rectangle r { Region.x = 0;  y = 0;  w = 10;  h = 10 };
+     Region.union_rectangle r { Region.x = 20;  y = 0;  w = 10;  h = 10 };
+     assert(Region.num_rectangles r = 2);
+     assert(Region.extents r = { Region.x = 0;  y = 0;  w = 30;  h = 10 });
+     assert(Region.contains_point r 5 5);
+     assert(not(Region.contains_point r 15 5));
+     assert(Region.contains_rectangle
+              r { Region.x = 5;  y = 0;  w = 10;  h = 5 } = Region.PART);
+     let r2 = Region.copy r in
+     Region.subtract_rectangle r2 { Region.x = 0;  y = 0;  w = 10;  h = 10 };
+     assert(Region.num_rectangles r2 = 1);
+     assert(Region.fold (fun a rect -> a + rect.Region.w * rect.Region.h) r 0
+            = 200);
+     Region.xor r2 r;
+     assert(Region.equal r2
+              (Region.of_rectangles [| { Region.x = 0;  y = 0;  w = 10;
+                                         h = 10 } |]));
+     (try ignore(Region.get_rectangle r 2);  assert false
+      with Invalid_argument _ -> ());
+     (* Clip to the region and paint. *)
+     let img = Image.create Image.A8 ~w:40 ~h:10 in
+     let cr = create img in
+     Region.clip cr r;
+     paint cr;
+     Surface.flush img;
+     let data = Image.get_data8 img in
+     let stride = Image.get_stride img in
+     assert(data.{5 * stride + 5} = 255);
+     assert(data.{5 * stride + 15} = 0);
+     assert(data.{5 * stride + 25} = 255);
+     Region.mark_dirty img r
@@ -0,0 +1,42 @@
+open Cairo
+
+let () =
+  let data = Bigarray.(Array2.create int32 c_layout 16 64) in
+  Bigarray.Array2.fill data 0l;
+  let sheet = Image.create_for_data32 ~alpha:true data in
+  match Surface.create_for_rectangle sheet ~x:16. ~y:0. ~w:16. ~h:16. with
+  | exception Unavailable -> print_endline "Sub-surfaces unavailable"
+  | icon ->
+     (* Drawing on the view draws on the sheet, at an offset. *)
+     let cr = create icon in
+     set_source_rgb cr 1. 0. 0.;
+     rectangle cr 0. 0. ~w:4. ~h:4.;
+     fill cr;
+     Surface.flush icon;
+     assert(data.{1, 17} = 0xFFFF0000l);
+     assert(data.{1, 1} = 0l);
+     (* Using the view as a source reads the sheet. *)
+     let img = Image.create Image.ARGB32 ~w:16 ~h:16 in
+     let cr = create img in
+     set_source_surface cr icon ~x:0. ~y:0.;
+     paint cr;
+     Surface.flush img;
+     let d = Image.get_data32 img in
+     assert(d.{1, 1} = 0xFFFF0000l);
+     assert(d.{8, 8} = 0l);
+     (* The pixels stay alive as long as the view, even when the image
+        and its bigarray are collected. *)
+     let view () =
+       let data = Bigarray.(Array2.create int32 c_layout 16 64) in
+       Bigarray.Array2.fill data 0xFF00FF00l;
+       let sheet = Image.create_for_data32 ~alpha:true data in
+       Surface.create_for_rectangle sheet ~x:16. ~y:0. ~w:16. ~h:16. in
+     let icon = view () in
+     Gc.full_major ();
+     ignore(Bigarray.(Array2.create int32 c_layout 16 64));
+     let cr = create img in
+     set_source_surface cr icon ~x:0. ~y:0.;
+     paint cr;
+     Surface.flush img;
+     assert((Image.get_data32 img).{8, 8} = 0xFF00FF00l);
+     Gc.full_major ()
@@ -0,0 +1,39 @@
+open Printf
+open Cairo
+
+let pi = 4. *. atan 1.
+
+let draw cr =
+  set_source_rgb cr 1. 1. 1.;
+  paint cr;
+  set_source_rgb cr 0.2 0.4 0.8;
+  arc cr 150. 100. ~r:80. ~a1:0. ~a2:(2. *. pi);
+  fill cr;
+  set_source_rgba cr 0.8 0.1 0.1 0.5;
+  set_line_width cr 7.;
+  move_to cr 10. 10.;
+  line_to cr 290. 190.;
+  stroke cr
+
+(* Tiles are pixel aligned, so the result should be the same as
+   drawing the whole image at once. *)
+let () =
+  let w = 300 and h = 200 in
+  let whole = Image.create Image.ARGB32 ~w ~h in
+  draw (create whole);
+  Surface.flush whole;
+  let tiled = Image.create Image.ARGB32 ~w ~h in
+  let ntasks = ref 0 in
+  let run tasks =
+    ntasks := List.length tasks;
+    List.iter (fun f -> f ()) tasks in
+  Tiled.render ~tile:70 ~run tiled draw;
+  (* 300 = 96 + 96 + 96 + 12 and 200 = 70 + 70 + 60 *)
+  assert(!ntasks = 4 * 3);
+  let d1 = Image.get_data8 whole and d2 = Image.get_data8 tiled in
+  let diff = ref 0 in
+  for i = 0 to Bigarray.Array1.dim d1 - 1 do
+    diff := max !diff (abs (d1.{i} - d2.{i}))
+  done;
+  printf "Tiled rendering, max difference: %d\n" !diff;
+  assert(!diff <= 1)